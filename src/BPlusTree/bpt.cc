@@ -3,6 +3,7 @@
 #include <stdlib.h>
 
 #include <list>
+#include <vector>
 #include <algorithm>
 using std::swap;
 using std::binary_search;
@@ -33,26 +34,222 @@ inline record_t *find(leaf_node_t &node, const key_t &key) {
     return lower_bound(begin(node), end(node), key);
 }
 
+/* first of the `total` items that goes to node `k` when split evenly */
+inline size_t split_point(size_t total, size_t nodes, size_t k) {
+    return k * (total / nodes) + std::min(k, total % nodes);
+}
+
+/* how many nodes hold `total` items at `per_node` each, never leaving one
+ * below half of the order */
+inline size_t node_count(size_t total, size_t per_node) {
+    size_t nodes = (total + per_node - 1) / per_node;
+    size_t most = total / (BP_ORDER / 2);
+    return std::max<size_t>(1, std::min(nodes, most));
+}
+
 bplus_tree::bplus_tree(const char *p, bool force_empty)
-    : fp(NULL), fp_level(0)
+    : fp(NULL), meta_dirty(false)
 {
     bzero(path, sizeof(path));
     strcpy(path, p);
 
-    if (!force_empty)
+    if (!force_empty) {
         // read tree from file
-        if (map(&meta, OFFSET_META) != 0)
+        // `rb+` will make sure we can write everywhere without truncating file
+        fp = fopen(path, "rb+");
+        if (fp == NULL || map(&meta, OFFSET_META) != 0)
             force_empty = true;
+    }
 
     if (force_empty) {
-        open_file("w+"); // truncate file
+        if (fp != NULL)
+            fclose(fp);
+        fp = fopen(path, "w+"); // truncate file
 
         // create empty tree if file doesn't exist
         init_from_empty();
-        close_file();
     }
 }
 
+bplus_tree::~bplus_tree()
+{
+    flush();
+    fclose(fp);
+}
+
+void bplus_tree::flush()
+{
+    for (std::list<page_t>::iterator it = pages.begin(); it != pages.end(); ++it)
+        write_back(*it);
+
+    if (meta_dirty) {
+        fseek(fp, OFFSET_META, SEEK_SET);
+        fwrite(&meta, sizeof(meta_t), 1, fp);
+        meta_dirty = false;
+    }
+
+    fflush(fp);
+}
+
+page_t *bplus_tree::fetch(off_t offset) const
+{
+    std::unordered_map<off_t, std::list<page_t>::iterator>::iterator found =
+        page_table.find(offset);
+    if (found != page_table.end()) {
+        pages.splice(pages.begin(), pages, found->second);
+        return &pages.front();
+    }
+
+    // evict the least recently used page
+    if (pages.size() >= BP_CACHE_PAGES) {
+        write_back(pages.back());
+        page_table.erase(pages.back().offset);
+        pages.pop_back();
+    }
+
+    pages.push_front(page_t());
+    page_t &page = pages.front();
+    page.offset = offset;
+    page.dirty = 0;
+
+    // blocks past the end of file are new, they read as zeroes
+    fseek(fp, offset, SEEK_SET);
+    size_t rd = fread(page.data, 1, sizeof(page.data), fp);
+    bzero(page.data + rd, sizeof(page.data) - rd);
+
+    page_table[offset] = pages.begin();
+    return &page;
+}
+
+void bplus_tree::write_back(page_t &page) const
+{
+    // only the bytes written through unmap belong to this block, the rest of
+    // the page may overlap the next block
+    if (page.dirty > 0) {
+        fseek(fp, page.offset, SEEK_SET);
+        fwrite(page.data, page.dirty, 1, fp);
+        page.dirty = 0;
+    }
+}
+
+int bplus_tree::bulk_load(record_source_t &source, size_t n,
+                          double fill_factor)
+{
+    reset_file();
+    if (n == 0) {
+        init_from_empty();
+        return 0;
+    }
+
+    fill_factor = std::max(0.5, std::min(1.0, fill_factor));
+    size_t per_node = std::max<size_t>(2, BP_ORDER * fill_factor);
+
+    // nodes per level, leafs first, then internal levels up to the root
+    std::vector<size_t> level_nodes(1, node_count(n, per_node));
+    do {
+        level_nodes.push_back(node_count(level_nodes.back(), per_node));
+    } while (level_nodes.back() > 1);
+
+    // every level is stored contiguously, so all offsets are known upfront
+    std::vector<off_t> level_offset(1, OFFSET_BLOCK);
+    level_offset.push_back(OFFSET_BLOCK + level_nodes[0] * sizeof(leaf_node_t));
+    for (size_t l = 1; l + 1 < level_nodes.size(); ++l)
+        level_offset.push_back(level_offset[l] +
+                               level_nodes[l] * sizeof(internal_node_t));
+
+    // smallest key under each node of the last written level
+    std::vector<key_t> first_keys;
+    first_keys.reserve(level_nodes[0]);
+
+    // leafs
+    size_t leafs = level_nodes[0];
+    size_t parent = 0;
+    record_t last;
+    fseek(fp, level_offset[0], SEEK_SET);
+    for (size_t k = 0; k < leafs; ++k) {
+        leaf_node_t leaf;
+        bzero(&leaf, sizeof(leaf));
+        while (split_point(leafs, level_nodes[1], parent + 1) <= k)
+            ++parent;
+        leaf.parent = level_offset[1] + parent * sizeof(internal_node_t);
+        leaf.prev = k == 0 ? 0 : level_offset[0] + (k - 1) * sizeof(leaf_node_t);
+        leaf.next = k + 1 == leafs ? 0 : level_offset[0] + (k + 1) * sizeof(leaf_node_t);
+        leaf.n = split_point(n, leafs, k + 1) - split_point(n, leafs, k);
+
+        for (size_t i = 0; i < leaf.n; ++i) {
+            record_t *record = leaf.children + i;
+            if (!source.next(record) ||
+                ((k > 0 || i > 0) && keycmp(last.key, record->key) >= 0)) {
+                // short or unsorted input, leave an empty tree behind
+                reset_file();
+                init_from_empty();
+                return -1;
+            }
+            last = *record;
+        }
+
+        first_keys.push_back(leaf.children[0].key);
+        fwrite(&leaf, sizeof(leaf), 1, fp);
+    }
+
+    // internal levels, bottom-up
+    for (size_t l = 1; l < level_nodes.size(); ++l) {
+        size_t children = level_nodes[l - 1];
+        size_t nodes = level_nodes[l];
+        size_t child_size = l == 1 ? sizeof(leaf_node_t) : sizeof(internal_node_t);
+        bool root = l + 1 == level_nodes.size();
+        std::vector<key_t> keys;
+        keys.reserve(nodes);
+
+        parent = 0;
+        for (size_t k = 0; k < nodes; ++k) {
+            internal_node_t node;
+            bzero(&node, sizeof(node));
+            if (!root) {
+                while (split_point(nodes, level_nodes[l + 1], parent + 1) <= k)
+                    ++parent;
+                node.parent = level_offset[l + 1] + parent * sizeof(internal_node_t);
+            }
+            node.prev = k == 0 ? 0 : level_offset[l] + (k - 1) * sizeof(internal_node_t);
+            node.next = k + 1 == nodes ? 0 : level_offset[l] + (k + 1) * sizeof(internal_node_t);
+
+            // key of each child is the smallest key of the child after it,
+            // the last one bounds the node like the parent's key does
+            size_t first = split_point(children, nodes, k);
+            size_t end = split_point(children, nodes, k + 1);
+            node.n = end - first;
+            for (size_t c = first; c < end; ++c) {
+                index_t *index = node.children + (c - first);
+                index->child = level_offset[l - 1] + c * child_size;
+                if (c + 1 < children)
+                    index->key = first_keys[c + 1];
+            }
+
+            keys.push_back(first_keys[first]);
+            fwrite(&node, sizeof(node), 1, fp);
+        }
+
+        first_keys.swap(keys);
+    }
+
+    // meta
+    bzero(&meta, sizeof(meta_t));
+    meta.order = BP_ORDER;
+    meta.value_size = sizeof(value_t);
+    meta.key_size = sizeof(key_t);
+    meta.leaf_node_num = leafs;
+    for (size_t l = 1; l < level_nodes.size(); ++l)
+        meta.internal_node_num += level_nodes[l];
+    meta.height = level_nodes.size() - 1;
+    meta.root_offset = level_offset.back();
+    meta.leaf_offset = OFFSET_BLOCK;
+    meta.slot = meta.root_offset + sizeof(internal_node_t);
+    meta_dirty = true;
+    flush();
+
+    return 0;
+}
+
 int bplus_tree::search(const key_t& key, value_t *value) const
 {
     leaf_node_t leaf;
@@ -645,6 +842,14 @@ void bplus_tree::node_remove(T *prev, T *node)
     unmap(&meta, OFFSET_META);
 }
 
+void bplus_tree::reset_file()
+{
+    pages.clear();
+    page_table.clear();
+    fclose(fp);
+    fp = fopen(path, "w+");
+}
+
 void bplus_tree::init_from_empty()
 {
     // init default meta
@@ -6,6 +6,9 @@
 #include <stdlib.h>
 #include <assert.h>
 
+#include <list>
+#include <unordered_map>
+
 #ifndef UNIT_TEST
 #include "predefined.h"
 #else
@@ -68,10 +71,31 @@ struct leaf_node_t {
     record_t children[BP_ORDER];
 };
 
+/* cached block of the tree file */
+struct page_t {
+    off_t offset;
+    size_t dirty; /* how many leading bytes must be written back */
+    char data[sizeof(internal_node_t) > sizeof(leaf_node_t) ?
+              sizeof(internal_node_t) : sizeof(leaf_node_t)];
+};
+
+/* sorted input for bulk loading */
+class record_source_t {
+public:
+    virtual ~record_source_t() {}
+
+    /* store the next record, false when there is none left */
+    virtual bool next(record_t *record) = 0;
+};
+
 /* the encapulated B+ tree */
 class bplus_tree {
 public:
     bplus_tree(const char *path, bool force_empty = false);
+    ~bplus_tree();
+
+    /* write every dirty page and the meta back to disk */
+    void flush();
 
     /* abstract operations */
     int search(const key_t& key, value_t *value) const;
@@ -80,6 +104,11 @@ public:
     int remove(const key_t& key);
     int insert(const key_t& key, value_t value);
     int update(const key_t& key, value_t value);
+
+    /* replace the tree with `n` records of strictly increasing keys, built
+     * bottom-up in one sequential pass, nodes filled to `fill_factor` */
+    int bulk_load(record_source_t &source, size_t n, double fill_factor = 1.0);
+
     meta_t get_meta() const {
         return meta;
     };
@@ -95,6 +124,9 @@ public:
     /* init empty tree */
     void init_from_empty();
 
+    /* truncate the file and drop every cached page */
+    void reset_file();
+
     /* find index */
     off_t search_index(const key_t &key) const;
 
@@ -145,25 +177,20 @@ public:
     template<class T>
     void node_remove(T *prev, T *node);
 
-    /* multi-level file open/close */
-    mutable FILE *fp;
-    mutable int fp_level;
-    void open_file(const char *mode = "rb+") const
-    {
-        // `rb+` will make sure we can write everywhere without truncating file
-        if (fp_level == 0)
-            fp = fopen(path, mode);
+    /* the file stays open for the tree's lifetime */
+    FILE *fp;
 
-        ++fp_level;
-    }
+    /* page cache, most recently used first */
+    mutable std::list<page_t> pages;
+    mutable std::unordered_map<off_t, std::list<page_t>::iterator> page_table;
+    mutable bool meta_dirty;
 
-    void close_file() const
-    {
-        if (fp_level == 1)
-            fclose(fp);
+    /* find block in cache, reading it from disk (and evicting) if needed */
+    page_t *fetch(off_t offset) const;
+    void write_back(page_t &page) const;
 
-        --fp_level;
-    }
+    bplus_tree(const bplus_tree &);
+    bplus_tree &operator=(const bplus_tree &);
 
     /* alloc from disk */
     off_t alloc(size_t size)
@@ -197,15 +224,20 @@ public:
         --meta.internal_node_num;
     }
 
-    /* read block from disk */
+    /* read block from cache */
     int map(void *block, off_t offset, size_t size) const
     {
-        open_file();
-        fseek(fp, offset, SEEK_SET);
-        size_t rd = fread(block, size, 1, fp);
-        close_file();
+        if (offset == OFFSET_META) {
+            fseek(fp, offset, SEEK_SET);
+            size_t rd = fread(block, size, 1, fp);
+
+            return rd - 1;
+        }
 
-        return rd - 1;
+        page_t *page = fetch(offset);
+        memcpy(block, page->data, size);
+
+        return 0;
     }
 
     template<class T>
@@ -214,15 +246,21 @@ public:
         return map(block, offset, sizeof(T));
     }
 
-    /* write block to disk */
+    /* write block to cache, it reaches disk on eviction or flush */
     int unmap(void *block, off_t offset, size_t size) const
     {
-        open_file();
-        fseek(fp, offset, SEEK_SET);
-        size_t wd = fwrite(block, size, 1, fp);
-        close_file();
-
-        return wd - 1;
+        if (offset == OFFSET_META) {
+            // always written from `meta` itself
+            meta_dirty = true;
+            return 0;
+        }
+
+        page_t *page = fetch(offset);
+        memcpy(page->data, block, size);
+        if (page->dirty < size)
+            page->dirty = size;
+
+        return 0;
     }
 
     template<class T>
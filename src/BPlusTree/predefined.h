@@ -1,15 +1,25 @@
 #ifndef PREDEFINED_H
 #define PREDEFINED_H
 
+#include <stdlib.h>
 #include <string.h>
 
 namespace bpt {
 
 /* predefined B+ info */
+#ifdef BP_STRING_KEY
 #define BP_ORDER 20
+#else
+#define BP_ORDER 64
+#endif
+
+/* how many blocks the tree keeps in memory */
+#define BP_CACHE_PAGES 4096
 
 /* key/value type */
 typedef int value_t;
+
+#ifdef BP_STRING_KEY
 struct key_t {
     char k[16];
 
@@ -24,6 +34,21 @@ inline int keycmp(const key_t &a, const key_t &b) {
     int x = strlen(a.k) - strlen(b.k);
     return x == 0 ? strcmp(a.k, b.k) : x;
 }
+#else
+/* native int keys, compared with a single instruction */
+struct key_t {
+    int k;
+
+    key_t(int key = 0) : k(key) {}
+
+    /* parse decimal strings, used by the command line tools */
+    key_t(const char *str) : k(atoi(str)) {}
+};
+
+inline int keycmp(const key_t &a, const key_t &b) {
+    return (a.k > b.k) - (a.k < b.k);
+}
+#endif
 
 #define OPERATOR_KEYCMP(type) \
     bool operator< (const key_t &l, const type &r) {\
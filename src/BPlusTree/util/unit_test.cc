@@ -565,6 +565,112 @@ int main(int argc, char *argv[])
 
     PRINT("InsertManyKeysRandom");
 
+    {
+    bplus_tree tree("test.db", true);
+    for (int i = 0; i < size; i++) {
+        char key[8] = { 0 };
+        sprintf(key, "%d", numbers[i]);
+        assert(tree.insert(key, numbers[i]) == 0);
+    }
+    assert(tree.pages.size() == BP_CACHE_PAGES);
+    tree.flush();
+
+    // a second reader only sees what has been written back
+    bplus_tree reader("test.db");
+    assert(reader.meta.leaf_node_num == tree.meta.leaf_node_num);
+    for (int i = 0; i < size; i++) {
+        char key[8] = { 0 };
+        sprintf(key, "%d", numbers[i]);
+        bpt::value_t value;
+        assert(reader.search(key, &value) == 0);
+        assert(value == numbers[i]);
+    }
+    PRINT("FlushCachedPages");
+    }
+
+    struct sorted_source_t : public bpt::record_source_t {
+        int i, end;
+        sorted_source_t(int end) : i(0), end(end) {}
+        bool next(bpt::record_t *record) {
+            if (i == end)
+                return false;
+            char key[16] = { 0 };
+            sprintf(key, "%04d", i);
+            record->key = key;
+            record->value = i++;
+            return true;
+        }
+    };
+
+    {
+    int counts[] = { 1, 2, 3, 5, 17, size };
+    double fills[] = { 0.5, 0.75, 1.0 };
+    for (int c = 0; c < 6; c++)
+    for (int f = 0; f < 3; f++) {
+        {
+        bplus_tree tree("test.db", true);
+        sorted_source_t source(counts[c]);
+        assert(tree.bulk_load(source, counts[c], fills[f]) == 0);
+        }
+
+        bplus_tree tree("test.db");
+        size_t leafs = 0;
+        bpt::leaf_node_t leaf;
+        for (off_t off = tree.meta.leaf_offset; off != 0; off = leaf.next) {
+            tree.map(&leaf, off);
+            assert(leaf.n <= tree.meta.order);
+            assert(tree.meta.leaf_node_num == 1 || leaf.n >= tree.meta.order / 2);
+            ++leafs;
+        }
+        assert(leafs == tree.meta.leaf_node_num);
+
+        for (int i = 0; i < counts[c]; i++) {
+            char key[16] = { 0 };
+            sprintf(key, "%04d", i);
+            bpt::value_t value;
+            assert(tree.search(key, &value) == 0);
+            assert(value == i);
+        }
+
+        // the loaded tree keeps working with the incremental operations
+        assert(tree.insert("9999", 9999) == 0);
+        for (int i = 0; i < counts[c]; i++) {
+            char key[16] = { 0 };
+            sprintf(key, "%04d", i);
+            assert(tree.remove(key) == 0);
+        }
+        bpt::value_t value;
+        assert(tree.search("9999", &value) == 0);
+        assert(value == 9999);
+    }
+
+    bplus_tree tree("test.db", true);
+    sorted_source_t source(size);
+    bpt::value_t values[size];
+    assert(tree.bulk_load(source, size) == 0);
+    bpt::key_t left = "0010";
+    assert(tree.search_range(&left, "0100", values, size) == 91);
+    for (int i = 0; i < 91; i++)
+        assert(values[i] == 10 + i);
+
+    // unsorted input leaves an empty tree
+    struct reversed_source_t : public bpt::record_source_t {
+        int i;
+        reversed_source_t() : i(10) {}
+        bool next(bpt::record_t *record) {
+            char key[16] = { 0 };
+            sprintf(key, "%04d", --i);
+            record->key = key;
+            record->value = i;
+            return true;
+        }
+    } reversed;
+    assert(tree.bulk_load(reversed, 10) == -1);
+    assert(tree.meta.leaf_node_num == 1);
+    assert(tree.search("0005", &values[0]) != 0);
+    PRINT("BulkLoad");
+    }
+
     {
     for (int i = 0; i < size; i++)
         numbers[i] = i;
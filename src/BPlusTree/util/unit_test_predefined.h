@@ -8,6 +8,9 @@ namespace bpt {
 /* predefined B+ info */
 #define BP_ORDER 4
 
+/* how many blocks the tree keeps in memory */
+#define BP_CACHE_PAGES 8
+
 /* key/value type */
 typedef int value_t;
 struct key_t {
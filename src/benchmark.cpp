@@ -10,11 +10,15 @@ void search_range_bplus(const Schema &schema, int lowkey, int highkey) {
     int size = (highkey - lowkey) + 1;
     bool next;
     bpt::value_t *values = new bpt::value_t[size];
-    bpt::key_t lk = bpt::key_t(std::to_string(lowkey).c_str());
-    schema.bplus->search_range(&lk, bpt::key_t(std::to_string(highkey).c_str()), values, size, &next);
+    bpt::key_t lk = bpt::key_t(lowkey);
+    schema.bplus->search_range(&lk, bpt::key_t(highkey), values, size, &next);
     delete [] values;
 }
 
+void search_range_hash(const Schema &schema, int lowkey, int highkey) {
+    for(int i = lowkey; i < highkey; ++i ) schema.search_for_key_indirect_hash(i);
+}
+
 void search_range_raw(const Schema &schema, int lowkey, int highkey, const std::string &filename) {
     for(int i = lowkey; i < highkey; ++i ) schema.search_for_key_raw(i, filename);
 }
@@ -27,6 +31,10 @@ void search_set_bplus(const Schema &schema, std::vector<int> set) {
     for(const auto& element: set) schema.search_for_key_bplus(element);
 }
 
+void search_set_hash(const Schema &schema, std::vector<int> set) {
+    for(const auto& element: set) schema.search_for_key_indirect_hash(element);
+}
+
 void search_set_raw(const Schema &schema, std::vector<int> set, const std::string &filename) {
     for(const auto& element: set) schema.search_for_key_raw(element, filename);
 }
\ No newline at end of file
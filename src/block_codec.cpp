@@ -0,0 +1,140 @@
+#include "block_codec.hpp"
+
+#include <cstdint>
+#include <cstring>
+
+namespace {
+
+const std::size_t MIN_MATCH = 4;
+const std::size_t MAX_OFFSET = 65535;
+const int HASH_BITS = 14;
+
+inline uint32_t hash_sequence(const char* bytes) {
+    uint32_t sequence;
+    memcpy(&sequence, bytes, sizeof(sequence));
+    return (sequence * 2654435761u) >> (32 - HASH_BITS);
+}
+
+// The part of a length past its 4-bit nibble.
+void put_length(std::vector<char>& out, std::size_t length) {
+    for(; length >= 255; length -= 255) {
+        out.push_back(static_cast<char>(255));
+    }
+    out.push_back(static_cast<char>(length));
+}
+
+bool get_length(const unsigned char*& in, const unsigned char* end, std::size_t& length) {
+    unsigned char byte;
+    do {
+        if(in == end) {
+            return false;
+        }
+        byte = *in++;
+        length += byte;
+    } while(byte == 255);
+    return true;
+}
+
+// match_length 0 ends the block with the literals.
+void put_sequence(std::vector<char>& out, const char* literals, std::size_t literal_count,
+                  std::size_t offset, std::size_t match_length) {
+    std::size_t match_code = match_length ? match_length - MIN_MATCH : 0;
+    unsigned char token = (literal_count < 15 ? literal_count : 15) << 4 | (match_code < 15 ? match_code : 15);
+    out.push_back(static_cast<char>(token));
+    if(literal_count >= 15) {
+        put_length(out, literal_count - 15);
+    }
+    out.insert(out.end(), literals, literals + literal_count);
+    if(match_length) {
+        out.push_back(static_cast<char>(offset & 0xff));
+        out.push_back(static_cast<char>(offset >> 8));
+        if(match_code >= 15) {
+            put_length(out, match_code - 15);
+        }
+    }
+}
+
+}
+
+bool compress_block(const char* in, std::size_t size, std::vector<char>& out) {
+    out.clear();
+    out.reserve(size);
+    // Last position + 1 each hashed sequence was seen at, 0 for none.
+    std::vector<uint32_t> table(std::size_t(1) << HASH_BITS, 0);
+
+    std::size_t anchor = 0;
+    std::size_t i = 0;
+    while(i + MIN_MATCH <= size) {
+        uint32_t& slot = table[hash_sequence(in + i)];
+        std::size_t candidate = slot;
+        slot = i + 1;
+        if(candidate == 0 || i - (candidate - 1) > MAX_OFFSET || memcmp(in + candidate - 1, in + i, MIN_MATCH) != 0) {
+            i++;
+            continue;
+        }
+
+        const std::size_t match = candidate - 1;
+        std::size_t length = MIN_MATCH;
+        while(i + length < size && in[match + length] == in[i + length]) {
+            length++;
+        }
+        put_sequence(out, in + anchor, i - anchor, i - match, length);
+        i += length;
+        anchor = i;
+        if(out.size() >= size) {
+            return false;
+        }
+    }
+    put_sequence(out, in + anchor, size - anchor, 0, 0);
+    return out.size() < size;
+}
+
+bool decompress_block(const char* in, std::size_t size, char* out, std::size_t out_size) {
+    const unsigned char* ip = reinterpret_cast<const unsigned char*>(in);
+    const unsigned char* end = ip + size;
+    char* op = out;
+    char* const out_end = out + out_size;
+
+    while(ip < end) {
+        const unsigned char token = *ip++;
+        std::size_t literal_count = token >> 4;
+        if(literal_count == 15 && !get_length(ip, end, literal_count)) {
+            return false;
+        }
+        if(literal_count > static_cast<std::size_t>(end - ip) || literal_count > static_cast<std::size_t>(out_end - op)) {
+            return false;
+        }
+        memcpy(op, ip, literal_count);
+        ip += literal_count;
+        op += literal_count;
+        if(ip == end) {
+            break;
+        }
+
+        if(end - ip < 2) {
+            return false;
+        }
+        const std::size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        std::size_t length = token & 15;
+        if(length == 15 && !get_length(ip, end, length)) {
+            return false;
+        }
+        length += MIN_MATCH;
+        if(offset == 0 || offset > static_cast<std::size_t>(op - out) || length > static_cast<std::size_t>(out_end - op)) {
+            return false;
+        }
+        // Overlapping matches repeat the last offset bytes.
+        const char* match = op - offset;
+        if(offset >= length) {
+            memcpy(op, match, length);
+        }
+        else {
+            for(std::size_t k = 0; k < length; k++) {
+                op[k] = match[k];
+            }
+        }
+        op += length;
+    }
+    return op == out_end;
+}
@@ -0,0 +1,19 @@
+#ifndef BLOCK_CODEC_H
+#define BLOCK_CODEC_H
+
+#include <cstddef>
+#include <vector>
+
+// Byte-oriented LZ77 codec for blocks of at most 64KiB, in the spirit of
+// LZ4: a sequence is a token (literal count and match length nibbles, 15
+// meaning more length bytes follow), the literals, then a 2-byte offset back
+// into the output and the match length. The last sequence has literals only.
+// Runs of padding and repeated text turn into short matches, and decoding is
+// mostly memcpy.
+
+// Compresses size bytes into out, false if that would not make them smaller.
+bool compress_block(const char* in, std::size_t size, std::vector<char>& out);
+// Fills exactly out_size bytes, false if the input is malformed.
+bool decompress_block(const char* in, std::size_t size, char* out, std::size_t out_size);
+
+#endif // BLOCK_CODEC_H
@@ -0,0 +1,132 @@
+#include "block_nested_join.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include "hash_index.hpp"
+#include "parallel.hpp"
+
+namespace {
+
+// Chunks up to this many rows are compared one key after the other.
+const std::size_t SMALL_CHUNK_ROWS = 16;
+const std::size_t MIN_CHUNK_ROWS = 1024;
+
+// One chunk of outer keys, key_size bytes each, with a linear probing table
+// of their indexes at load factor one half at most.
+struct Chunk {
+    std::size_t key_size;
+    std::vector<char> keys;
+    std::vector<uint64_t> hashes;
+    std::vector<int> positions;
+    std::vector<uint32_t> table; // index + 1, 0 for a free slot
+    std::size_t mask;
+
+    std::size_t size() const {
+        return positions.size();
+    }
+
+    const char* key(std::size_t i) const {
+        return &keys[i * key_size];
+    }
+
+    void build_table() {
+        table.clear();
+        if(size() <= SMALL_CHUNK_ROWS) {
+            return;
+        }
+        std::size_t capacity = 16;
+        while(capacity < 2 * size()) {
+            capacity *= 2;
+        }
+        mask = capacity - 1;
+        table.assign(capacity, 0);
+        for(std::size_t i = 0; i < size(); i++) {
+            std::size_t slot = hashes[i] & mask;
+            while(table[slot] != 0) {
+                slot = (slot + 1) & mask;
+            }
+            table[slot] = i + 1;
+        }
+    }
+
+    // Appends the chunk indexes whose key equals key.
+    void find(const char* key, uint64_t hash, std::vector<uint32_t>& matches) const {
+        if(table.empty()) {
+            for(std::size_t i = 0; i < size(); i++) {
+                if(hashes[i] == hash && memcmp(this->key(i), key, key_size) == 0) {
+                    matches.push_back(i);
+                }
+            }
+            return;
+        }
+        for(std::size_t slot = hash & mask; table[slot] != 0; slot = (slot + 1) & mask) {
+            const std::size_t i = table[slot] - 1;
+            if(hashes[i] == hash && memcmp(this->key(i), key, key_size) == 0) {
+                matches.push_back(i);
+            }
+        }
+    }
+};
+
+inline uint64_t key_hash(const char* key, std::size_t key_size) {
+    return hash_bytes(key, strnlen(key, key_size));
+}
+
+}
+
+void block_nested_join_left(const JoinColumn& outer, const JoinColumn& inner, std::size_t memory_budget,
+                            unsigned threads, JoinSink& sink) {
+    Chunk chunk;
+    chunk.key_size = std::max(outer.size, inner.size);
+    // Key, hash, position and two table slots per outer row.
+    const std::size_t row_bytes = chunk.key_size + sizeof(uint64_t) + sizeof(int) + 2 * sizeof(uint32_t);
+    const std::size_t chunk_rows = std::max(MIN_CHUNK_ROWS, memory_budget / row_bytes);
+
+    const std::size_t outer_rows = outer.rel.get_row_count();
+    std::vector<char> matched;
+    for(std::size_t first = 0; first < outer_rows; first += chunk_rows) {
+        const std::size_t count = std::min(chunk_rows, outer_rows - first);
+        chunk.keys.resize(count * chunk.key_size);
+        chunk.hashes.resize(count);
+        chunk.positions.resize(count);
+        for(std::size_t i = 0; i < count; i++) {
+            char* key = &chunk.keys[i * chunk.key_size];
+            copy_join_key(join_value(outer, first + i), outer.size, key, chunk.key_size);
+            chunk.hashes[i] = key_hash(key, chunk.key_size);
+            chunk.positions[i] = outer.rel.get_position(first + i);
+        }
+        chunk.build_table();
+        matched.assign(count, 0);
+
+        // (chunk index, inner row) pairs of each morsel of the inner scan.
+        scan_morsels<std::vector<std::pair<uint32_t, int>>>(inner.rel.get_row_count(), threads,
+            [&](std::size_t begin, std::size_t end, std::vector<std::pair<uint32_t, int>>& pairs) {
+                std::vector<char> key(chunk.key_size);
+                std::vector<uint32_t> matches;
+                for(std::size_t j = begin; j < end; j++) {
+                    copy_join_key(join_value(inner, j), inner.size, key.data(), chunk.key_size);
+                    matches.clear();
+                    chunk.find(key.data(), key_hash(key.data(), chunk.key_size), matches);
+                    for(std::size_t m = 0; m < matches.size(); m++) {
+                        pairs.push_back(std::make_pair(matches[m], static_cast<int>(j)));
+                    }
+                }
+            },
+            [&](std::vector<std::pair<uint32_t, int>>& pairs) {
+                for(std::size_t p = 0; p < pairs.size(); p++) {
+                    matched[pairs[p].first] = 1;
+                    sink.consume(chunk.positions[pairs[p].first], inner.rel.get_position(pairs[p].second));
+                }
+            });
+
+        for(std::size_t i = 0; i < count; i++) {
+            if(!matched[i]) {
+                sink.consume(chunk.positions[i], -1);
+            }
+        }
+    }
+}
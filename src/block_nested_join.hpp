@@ -0,0 +1,18 @@
+#ifndef BLOCK_NESTED_JOIN_H
+#define BLOCK_NESTED_JOIN_H
+
+#include <cstddef>
+
+#include "join_key.hpp"
+#include "join_sink.hpp"
+
+// Left outer block nested-loop equi-join on string columns. The outer keys
+// are loaded in chunks that fit memory_budget and the inner relation is
+// scanned once per chunk, in parallel morsels, each inner key being compared
+// against the whole chunk (through a hash table on the chunk unless it is
+// tiny). Pairs reach the sink chunk by chunk, with (outer position, -1) for
+// the outer rows of a chunk that found no match. threads = 0 uses every core.
+void block_nested_join_left(const JoinColumn& outer, const JoinColumn& inner, std::size_t memory_budget,
+                            unsigned threads, JoinSink& sink);
+
+#endif // BLOCK_NESTED_JOIN_H
@@ -0,0 +1,47 @@
+#ifndef BLOOM_FILTER_H
+#define BLOOM_FILTER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Bits per key and bits set per key of a BloomFilter, about 1% false
+// positives.
+const std::size_t BLOOM_BITS_PER_KEY = 16;
+const int BLOOM_KEY_BITS = 5;
+
+// Register-blocked bloom filter over 64-bit key hashes: all the bits of a
+// key are in one 64-bit word, so a test is a single load and a mask compare.
+// The word is picked by the top half of the hash and the bits by the bottom
+// half. A join builds one from its inner keys and skips the outer rows the
+// filter rules out before partitioning or sorting them.
+class BloomFilter {
+public:
+    explicit BloomFilter(std::size_t keys) : words((keys * BLOOM_BITS_PER_KEY + 63) / 64 + 1, 0) {}
+
+    void add(uint64_t hash) {
+        words[word_of(hash)] |= mask_of(hash);
+    }
+
+    bool may_contain(uint64_t hash) const {
+        const uint64_t mask = mask_of(hash);
+        return (words[word_of(hash)] & mask) == mask;
+    }
+
+private:
+    std::size_t word_of(uint64_t hash) const {
+        return ((hash >> 32) * words.size()) >> 32;
+    }
+
+    static uint64_t mask_of(uint64_t hash) {
+        uint64_t mask = 0;
+        for(int i = 0; i < BLOOM_KEY_BITS; i++) {
+            mask |= uint64_t(1) << ((hash >> (6 * i)) & 63);
+        }
+        return mask;
+    }
+
+    std::vector<uint64_t> words;
+};
+
+#endif // BLOOM_FILTER_H
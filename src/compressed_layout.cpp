@@ -0,0 +1,47 @@
+#include "compressed_layout.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+#include "block_codec.hpp"
+#include "mapped_relation.hpp"
+
+bool write_compressed(const MappedRelation& rows, const std::string& compressed_filename) {
+    const int row_size = rows.get_row_size();
+    const std::size_t row_count = rows.get_row_count();
+    // Small relations get one block that just fits them.
+    const int rows_per_block = std::max<int>(1, std::min<std::size_t>(COMPRESSED_BLOCK_SIZE / row_size, row_count));
+    const int block_count = (row_count + rows_per_block - 1) / rows_per_block;
+
+    CompressedHeader header = {COMPRESSED_MAGIC, row_size, static_cast<int>(row_count), rows_per_block, block_count};
+    std::vector<uint64_t> offsets(block_count + 1);
+    offsets[0] = sizeof(header) + offsets.size() * sizeof(uint64_t);
+
+    FILE* compressed_file = fopen(compressed_filename.c_str(), "wb");
+    if(!compressed_file) {
+        return false;
+    }
+    fwrite(&header, sizeof(header), 1, compressed_file);
+    fwrite(offsets.data(), sizeof(uint64_t), offsets.size(), compressed_file); // filled in below
+
+    std::vector<char> compressed;
+    for(int b = 0; b < block_count; b++) {
+        const std::size_t first = static_cast<std::size_t>(b) * rows_per_block;
+        const std::size_t size = std::min<std::size_t>(rows_per_block, row_count - first) * row_size;
+        const char* block = rows.get_field(first, 0); // row-major, the block is contiguous
+        if(compress_block(block, size, compressed)) {
+            fwrite(compressed.data(), 1, compressed.size(), compressed_file);
+            offsets[b + 1] = offsets[b] + compressed.size();
+        }
+        else {
+            fwrite(block, 1, size, compressed_file);
+            offsets[b + 1] = offsets[b] + size;
+        }
+    }
+
+    fseek(compressed_file, sizeof(header), SEEK_SET);
+    fwrite(offsets.data(), sizeof(uint64_t), offsets.size(), compressed_file);
+    fclose(compressed_file);
+    return true;
+}
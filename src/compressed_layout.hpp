@@ -0,0 +1,29 @@
+#ifndef COMPRESSED_LAYOUT_H
+#define COMPRESSED_LAYOUT_H
+
+#include <cstdint>
+#include <string>
+
+class MappedRelation;
+
+// Compressed files group rows into blocks of about COMPRESSED_BLOCK_SIZE
+// bytes and store each block through block_codec.hpp, or as is when it does
+// not shrink. A directory after the header gives the file offset of every
+// block, so a single row is read by decompressing one block. Rows keep their
+// row-major positions, row * row_size, so indexes and joins work unchanged.
+const int COMPRESSED_MAGIC = 0x314b4c42; // "BLK1"
+const int COMPRESSED_BLOCK_SIZE = 64 * 1024; // rows per block are fitted to this
+
+struct CompressedHeader {
+    int magic;
+    int row_size;
+    int row_count;
+    int rows_per_block;
+    int block_count; // followed by block_count + 1 uint64_t block offsets, the last one is the end of the file
+};
+
+// Rewrites a row-major relation as compressed blocks, false if the file
+// cannot be created.
+bool write_compressed(const MappedRelation& rows, const std::string& compressed_filename);
+
+#endif // COMPRESSED_LAYOUT_H
@@ -1,6 +1,7 @@
 #include <cstring>
 #include <cstdio>
 #include <cstdlib>
+#include <exception>
 #include <getopt.h>
 #include <iostream>
 #include <string>
@@ -12,11 +13,19 @@
 
 void usage(const char* program) {
   std::cout << "usage: " << program << " --schemadb=<schemadb_filename> --schema=<schema_id> <mode> <mode options>" << std::endl;
-  std::cout << "\t" << "mode: --convert --in <.csv file> --out <.bin file>" << std::endl;
+  std::cout << "\t" << "mode: --convert --in <.csv file> --out <.bin file> [--threads <n>] [--layout <row|pax|compressed>]" << std::endl;
+  std::cout << "\t" << "mode: --print-bin --in <.bin file> [--threads <n>]" << std::endl;
+  std::cout << "\t" << "mode: --join --schema2 <schema_id> --in <.bin file> --in2 <.bin file> --field_name <column[,column...]> --join-type <natural_inner|natural_left|natural_right|natural_full|semi|anti> --join-impl <nested|nested_existing_index|nested_new_index|merge|hash|grace_hash> [--join-op <eq|lt|le|gt|ge|band>] [--band <d>] [--threads <n>] [--memory-budget <MB>]" << std::endl;
+  std::cout << "\t" << "mode: --search-field --in <.bin file> --field_name <column> --field_value <value> [--threads <n>]" << std::endl;
   std::cout << "\t" << "mode: --create-index --in <.bin file> --out <.index file>" << std::endl;
-  std::cout << "\t" << "mode: --create-index-bplus --in <.bin file> --out <.index file>" << std::endl;
+  std::cout << "\t" << "mode: --create-index --in <.bin file> --field_name <column> [--memory-budget <MB>] (writes <.bin file>.<column>.findex)" << std::endl;
+  std::cout << "\t" << "mode: --create-index-bplus --in <.bin file> --out <.index file> [--fill-factor <0.5 to 1>]" << std::endl;
+  std::cout << "\t" << "mode: --create-index-hash --in <.bin file> --out <.index file>" << std::endl;
+  std::cout << "\t" << "mode: --create-direct-hash --in <.csv file> --out <hash file>" << std::endl;
   std::cout << "\t" << "mode: --search-index --in <.index file> --key <key>" << std::endl;
   std::cout << "\t" << "mode: --search-index-bplus --in <.index file> --key <key>" << std::endl;
+  std::cout << "\t" << "mode: --search-index-hash --in <.index file> --key <key>" << std::endl;
+  std::cout << "\t" << "mode: --search-direct-hash --in <hash file> --key <key>" << std::endl;
 
   exit(EXIT_FAILURE);
 }
@@ -46,6 +55,9 @@ join_implementation string_to_join_implementation(std::string string_join_impl){
     else if(string_join_impl=="hash"){
         return HASH;
     }
+    else if(string_join_impl=="grace_hash"){
+        return GRACE_HASH;
+    }
     else return NESTED;
 }
 
@@ -62,18 +74,47 @@ join_type string_to_join_type(std::string string_join_type){
     else if(string_join_type=="natural_full"){
         return NATURAL_FULL;
     }    
+    else if(string_join_type=="semi"){
+        return SEMI;
+    }
+    else if(string_join_type=="anti"){
+        return ANTI;
+    }
     else return NATURAL_INNER;
 }
 
+join_operator string_to_join_operator(std::string string_join_op){
+    if(string_join_op=="lt"){
+        return LESS;
+    }
+    else if(string_join_op=="le"){
+        return LESS_EQUAL;
+    }
+    else if(string_join_op=="gt"){
+        return GREATER;
+    }
+    else if(string_join_op=="ge"){
+        return GREATER_EQUAL;
+    }
+    else if(string_join_op=="band"){
+        return BAND;
+    }
+    else return EQUAL;
+}
+
 int main(int argc, char *argv[]) {
   enum {
     OPERATION_CONVERT,
     OPERATION_PRINT_BIN,
     OPERATION_CREATE_INDEX,
     OPERATION_CREATE_INDEX_BPLUS,
+    OPERATION_CREATE_INDEX_HASH,
+    OPERATION_CREATE_DIRECT_HASH,
     OPERATION_LOAD_DATA,
     OPERATION_SEARCH_INDEX,
     OPERATION_SEARCH_INDEX_BPLUS,
+    OPERATION_SEARCH_INDEX_HASH,
+    OPERATION_SEARCH_DIRECT_HASH,
     OPERATION_SEARCH_BENCHMARK,
     OPERATION_JOIN,
     OPERATION_JOIN_BENCHMARK,
@@ -88,8 +129,12 @@ int main(int argc, char *argv[]) {
     {"print-bin", no_argument, &operation_flag, OPERATION_PRINT_BIN},
     {"create-index", no_argument, &operation_flag, OPERATION_CREATE_INDEX},
     {"create-index-bplus", no_argument, &operation_flag, OPERATION_CREATE_INDEX_BPLUS},
+    {"create-index-hash", no_argument, &operation_flag, OPERATION_CREATE_INDEX_HASH},
+    {"create-direct-hash", no_argument, &operation_flag, OPERATION_CREATE_DIRECT_HASH},
     {"search-index", no_argument, &operation_flag, OPERATION_SEARCH_INDEX},
     {"search-index-bplus", no_argument, &operation_flag, OPERATION_SEARCH_INDEX_BPLUS},
+    {"search-index-hash", no_argument, &operation_flag, OPERATION_SEARCH_INDEX_HASH},
+    {"search-direct-hash", no_argument, &operation_flag, OPERATION_SEARCH_DIRECT_HASH},
     {"search-benchmark", no_argument, &operation_flag, OPERATION_SEARCH_BENCHMARK},
     {"search-field", no_argument, &operation_flag, OPERATION_SEARCH_FIELD},
     {"load-data", no_argument, &operation_flag, OPERATION_LOAD_DATA},
@@ -104,6 +149,8 @@ int main(int argc, char *argv[]) {
     {"in2", required_argument, NULL, 0},
     {"join-type", required_argument, NULL, 0},
     {"join-impl", required_argument, NULL, 0},    
+    {"join-op", required_argument, NULL, 0},
+    {"band", required_argument, NULL, 0},
     {"out", required_argument, NULL, 'o'},
     {"key", required_argument, NULL, 0},
     {"pos",required_argument,NULL,0},
@@ -113,6 +160,10 @@ int main(int argc, char *argv[]) {
     {"indexfile", required_argument, NULL, 0},
     {"indexfile2", required_argument, NULL, 0},
     {"bplusfile", optional_argument, NULL, 0},
+    {"fill-factor", required_argument, NULL, 0},
+    {"memory-budget", required_argument, NULL, 0},
+    {"threads", required_argument, NULL, 0},
+    {"layout", required_argument, NULL, 0},
 
 
     {"help", no_argument, NULL, 'h'},
@@ -128,11 +179,17 @@ int main(int argc, char *argv[]) {
   int key = 0;
   int pos=0;
   int init_pos = 0;
+  double fill_factor = 1.0;
+  std::size_t memory_budget = 0;
+  unsigned threads = 0;
+  storage_layout layout = ROW_MAJOR;
   std::string field_name, field_value;
   std::string infile,infile2, outfile;
   std::string indexfile, indexfile2, bplusfile;
   join_implementation join_impl;
   join_type join_tp;
+  join_operator join_op = EQUAL;
+  int band = 0;
 
   while((ch = getopt_long(argc, argv, "hi:o:", long_options, &option_index)) != -1) {
     switch(ch) {
@@ -179,9 +236,28 @@ int main(int argc, char *argv[]) {
         else if(!strcmp(long_options[option_index].name, "bplusfile")) {
           bplusfile = std::string(optarg);
         }
+        else if(!strcmp(long_options[option_index].name, "fill-factor")) {
+          fill_factor = std::stod(std::string(optarg));
+        }
+        else if(!strcmp(long_options[option_index].name, "memory-budget")) {
+          memory_budget = std::stoul(std::string(optarg)) << 20;
+        }
+        else if(!strcmp(long_options[option_index].name, "threads")) {
+          threads = std::stoi(std::string(optarg));
+        }
+        else if(!strcmp(long_options[option_index].name, "layout")) {
+          std::string layout_name(optarg);
+          layout = (layout_name == "pax") ? PAX : (layout_name == "compressed") ? COMPRESSED : ROW_MAJOR;
+        }
         else if(!strcmp(long_options[option_index].name, "join-impl")) {
           join_impl = string_to_join_implementation(std::string(optarg));
         }
+        else if(!strcmp(long_options[option_index].name, "join-op")) {
+          join_op = string_to_join_operator(std::string(optarg));
+        }
+        else if(!strcmp(long_options[option_index].name, "band")) {
+          band = std::stoi(std::string(optarg));
+        }
         else if(!strcmp(long_options[option_index].name, "join-type")) {
           join_tp = string_to_join_type(std::string(optarg));
         }
@@ -204,209 +280,272 @@ int main(int argc, char *argv[]) {
   Schema schema,schema1,schema2;
 
 
-  switch(operation_flag) {
-    case -1:
-      std::cout << "error: no mode specified" << std::endl;
-      usage(argv[0]);
-      break;
-    case OPERATION_CONVERT:
-      std::cout << "mode: convert" << std::endl;
-      schema = schemadb.get_schema(schema_id);
-      schema.convert_to_bin(infile, outfile, true);
-      break;
-    case OPERATION_PRINT_BIN:
-      std::cout << "mode: print bin" << std::endl;
-      schema = schemadb.get_schema(schema_id);
-      schema.print_binary(infile);
-      break;
-    case OPERATION_CREATE_INDEX:
-      std::cout << "mode: create index" << std::endl;
-      schema = schemadb.get_schema(schema_id);
-      schema.create_index(infile, outfile);
-      break;
-    case OPERATION_CREATE_INDEX_BPLUS:
-      std::cout << "mode: create index w/ B+ tree" << std::endl;
-      schema = schemadb.get_schema(schema_id);
-      schema.create_index_bplus(infile, outfile);
-      break;
-    case OPERATION_LOAD_DATA:
-      std::cout << "mode: load data" << std::endl;
-      schema = schemadb.get_schema(schema_id);
-      schema.load_data(pos,infile);
-      /*for(int i=0;i<100;i++){
+  // A read that fails, such as one of a damaged compressed block, ends the command.
+  try {
+    switch(operation_flag) {
+      case -1:
+        std::cout << "error: no mode specified" << std::endl;
+        usage(argv[0]);
+        break;
+      case OPERATION_CONVERT:
+        std::cout << "mode: convert" << std::endl;
+        schema = schemadb.get_schema(schema_id);
+        schema.convert_to_bin(infile, outfile, true, threads, layout);
+        break;
+      case OPERATION_PRINT_BIN:
+        std::cout << "mode: print bin" << std::endl;
+        schema = schemadb.get_schema(schema_id);
+        schema.set_scan_threads(threads);
+        schema.print_binary(infile);
+        break;
+      case OPERATION_CREATE_INDEX:
+        std::cout << "mode: create index" << std::endl;
+        schema = schemadb.get_schema(schema_id);
+        if(!field_name.empty()) {
+          schema.create_field_index(infile, field_name, memory_budget ? memory_budget : Join_Conditions().memory_budget);
+        }
+        else {
+          schema.create_index(infile, outfile);
+        }
+        break;
+      case OPERATION_CREATE_INDEX_BPLUS:
+        std::cout << "mode: create index w/ B+ tree" << std::endl;
+        schema = schemadb.get_schema(schema_id);
+        schema.create_index_bplus(infile, outfile, fill_factor);
+        break;
+      case OPERATION_CREATE_INDEX_HASH:
+        std::cout << "mode: create index w/ hash table" << std::endl;
+        schema = schemadb.get_schema(schema_id);
+        schema.create_index_indirect_hash(infile, outfile);
+        break;
+      case OPERATION_CREATE_DIRECT_HASH:
+        std::cout << "mode: create direct hash file" << std::endl;
+        schema = schemadb.get_schema(schema_id);
+        schema.create_index_direct_hash(infile, outfile, true);
+        break;
+      case OPERATION_LOAD_DATA:
+        std::cout << "mode: load data" << std::endl;
+        schema = schemadb.get_schema(schema_id);
         schema.load_data(pos,infile);
-        pos+=schema.get_header_size()+schema.get_size();     
-      }*/
-      //schema.load_data(pos, infile);
-      break;
-    case OPERATION_SEARCH_INDEX:
-      std::cout << "mode: search index" << std::endl;
-      schema = schemadb.get_schema(schema_id);
-      schema.load_index(infile);
-      int aux;
-      aux = schema.search_for_key(key);
-      std::cout<<aux<<std::endl;
-      break;
-    case OPERATION_SEARCH_INDEX_BPLUS:
-      std::cout << "mode: search index w/ B+ tree" << std::endl;
-      schema = schemadb.get_schema(schema_id);
-      schema.load_index_bplus(infile);
-      schema.search_for_key_bplus(key);
-      break;
-    case OPERATION_SEARCH_FIELD:{
-      std::cout << "mode: search field" << std::endl;
-      schema = schemadb.get_schema(schema_id);
-      std::vector<int> row_vec = schema.search_field(field_name, field_value, infile, init_pos);
-      for (unsigned i=0; i<row_vec.size(); i++){
-        schema.load_data(row_vec[i],infile);
-      }
-      break;}
-    case OPERATION_SEARCH_BENCHMARK:    
-      {
-      std::cout << "mode: search methods benchmarking" << std::endl;
+        /*for(int i=0;i<100;i++){
+          schema.load_data(pos,infile);
+          pos+=schema.get_header_size()+schema.get_size();     
+        }*/
+        //schema.load_data(pos, infile);
+        break;
+      case OPERATION_SEARCH_INDEX:
+        std::cout << "mode: search index" << std::endl;
+        schema = schemadb.get_schema(schema_id);
+        schema.load_index(infile);
+        int aux;
+        aux = schema.search_for_key(key);
+        std::cout<<aux<<std::endl;
+        break;
+      case OPERATION_SEARCH_INDEX_BPLUS:
+        std::cout << "mode: search index w/ B+ tree" << std::endl;
+        schema = schemadb.get_schema(schema_id);
+        schema.load_index_bplus(infile);
+        std::cout<<schema.search_for_key_bplus(key)<<std::endl;
+        break;
+      case OPERATION_SEARCH_INDEX_HASH:
+        std::cout << "mode: search index w/ hash table" << std::endl;
+        schema = schemadb.get_schema(schema_id);
+        schema.load_index_indirect_hash(infile);
+        std::cout<<schema.search_for_key_indirect_hash(key)<<std::endl;
+        break;
+      case OPERATION_SEARCH_DIRECT_HASH:
+        std::cout << "mode: search direct hash file" << std::endl;
+        schema = schemadb.get_schema(schema_id);
+        pos = schema.search_for_key_direct_hash(key, infile);
+        std::cout<<pos<<std::endl;
+        if(pos != -1){
+          schema.load_data(pos, infile);
+          std::cout<<std::endl;
+        }
+        break;
+      case OPERATION_SEARCH_FIELD:{
+        std::cout << "mode: search field" << std::endl;
+        schema = schemadb.get_schema(schema_id);
+        schema.set_scan_threads(threads);
+        // One mapping (and dictionary load) for the search and all the hits.
+        MappedRelation rel(infile, schema.get_row_size());
+        std::vector<int> row_vec = schema.search_field(field_name, field_value, rel, init_pos);
+        for (unsigned i=0; i<row_vec.size(); i++){
+          schema.load_data(row_vec[i],rel);
+          std::cout<<std::endl;
+        }
+        break;}
+      case OPERATION_SEARCH_BENCHMARK:    
+        {
+        std::cout << "mode: search methods benchmarking" << std::endl;
       
-      std::string schemabin ("../data/schema/company.bin");
-      std::string index ("../data/schema/company.index");
-      std::string bindex ("../data/schema/company.bindex");
-      schema = schemadb.get_schema(schema_id);
+        std::string schemabin ("../data/schema/company.bin");
+        std::string index ("../data/schema/company.index");
+        std::string bindex ("../data/schema/company.bindex");
+        std::string hindex ("../data/schema/company.hindex");
+        schema = schemadb.get_schema(schema_id);
       
-      std::cout << "converting to bin" << std::endl;
-
-      // create files
-      schema.convert_to_bin(infile, schemabin);
-
-      std::cout << "creating index" << std::endl;
-
-      schema.create_index(schemabin, index);
-
-      std::cout << "creating bplus index" << std::endl;
-
-      schema.create_index_bplus(schemabin, bindex);
-
-      std::cout << "indexes have been created" << std::endl;
-
-      schema.load_index(index);
-      schema.load_index_bplus(bindex);
-
-      std::cout << "indexes have been loaded" << std::endl;
-
-      // gen search keys
-      std::default_random_engine rgen;
-      std::uniform_int_distribution<int> distribution(0,9808);
-      int key = distribution(rgen);
-
-      int lkey = 5000;
-      int hkey = 7000;
-
-      std::vector<int> randomset;
-      for (unsigned i = 0; i < 100; ++i) randomset.push_back(distribution(rgen));
-
-      std::cout << "random set has been generated" << std::endl;
-
-      // sigle key search
-      std::cout << "Single search" << std::endl << std::endl;;
-      std::cout << "Sequential Index" << std::endl;
-      BENCHMARK(schema.search_for_key(key));
-      std::cout << "BPlus" << std::endl;
-      BENCHMARK(schema.search_for_key_bplus(key));
-      std::cout << "Raw file brute force" << std::endl;
-      BENCHMARK(schema.search_for_key_raw(key, "../data/schema/company.bin"));
-      std::cout << std::endl;
-
-      // set search
-      std::cout << "Random set search" << std::endl << std::endl;;
-      std::cout << "Sequential Index" << std::endl; 
-      BENCHMARK(search_set(schema, randomset));
-      std::cout << "BPlus" << std::endl;
-      BENCHMARK(search_set_bplus(schema, randomset));
-      std::cout << "Raw file brute force" << std::endl;
-      BENCHMARK(search_set_raw(schema, randomset, "../data/schema/company.bin"));
-      std::cout << std::endl;
-
-      // range search
-      std::cout << "Range search" << std::endl << std::endl;
-      BENCHMARK(search_range(schema, lkey, hkey));
-      std::cout << "BPlus" << std::endl;
-      BENCHMARK(search_range_bplus(schema, lkey, hkey));
-      std::cout << "Raw file brute force" << std::endl;
-      BENCHMARK(search_range_raw(schema, lkey, hkey, "../data/schema/company.bin"));
-      std::cout << std::endl;      
-
-
-      break;
-      }
-    case OPERATION_JOIN:
-      {
-      std::cout << "mode: join" << std::endl;
-      schema1 = schemadb.get_schema(schema_id);
-      schema2 = schemadb.get_schema(schema_id2);  
-      Join_Conditions jc;
-      jc.rel1_filename=infile.c_str();
-      jc.rel2_filename=infile2.c_str();
-      jc.field_name=field_name;
-      jc.type=join_tp;
-      jc.implementation=join_impl;
-      if(jc.implementation == NESTED_EXISTING_INDEX){
-        
-        schema1.load_index(indexfile);
-        schema2.load_index(indexfile2);
-      }   
-
-      schema1.join(schema2,jc);
-
-      break;
-      }
-      case OPERATION_JOIN_BENCHMARK:{
+        std::cout << "converting to bin" << std::endl;
+
+        // create files
+        schema.convert_to_bin(infile, schemabin);
+
+        std::cout << "creating index" << std::endl;
+
+        schema.create_index(schemabin, index);
+
+        std::cout << "creating bplus index" << std::endl;
+
+        schema.create_index_bplus(schemabin, bindex);
+
+        std::cout << "creating hash index" << std::endl;
+
+        schema.create_index_indirect_hash(schemabin, hindex);
+
+        std::cout << "indexes have been created" << std::endl;
+
+        schema.load_index(index);
+        schema.load_index_bplus(bindex);
+        schema.load_index_indirect_hash(hindex);
+
+        std::cout << "indexes have been loaded" << std::endl;
+
+        // gen search keys
+        std::default_random_engine rgen;
+        std::uniform_int_distribution<int> distribution(0,9808);
+        int key = distribution(rgen);
+
+        int lkey = 5000;
+        int hkey = 7000;
+
+        std::vector<int> randomset;
+        for (unsigned i = 0; i < 100; ++i) randomset.push_back(distribution(rgen));
+
+        std::cout << "random set has been generated" << std::endl;
+
+        // sigle key search
+        std::cout << "Single search" << std::endl << std::endl;;
+        std::cout << "Sequential Index" << std::endl;
+        BENCHMARK(schema.search_for_key(key));
+        std::cout << "BPlus" << std::endl;
+        BENCHMARK(schema.search_for_key_bplus(key));
+        std::cout << "Hash" << std::endl;
+        BENCHMARK(schema.search_for_key_indirect_hash(key));
+        std::cout << "Raw file brute force" << std::endl;
+        BENCHMARK(schema.search_for_key_raw(key, "../data/schema/company.bin"));
+        std::cout << std::endl;
+
+        // set search
+        std::cout << "Random set search" << std::endl << std::endl;;
+        std::cout << "Sequential Index" << std::endl; 
+        BENCHMARK(search_set(schema, randomset));
+        std::cout << "BPlus" << std::endl;
+        BENCHMARK(search_set_bplus(schema, randomset));
+        std::cout << "Hash" << std::endl;
+        BENCHMARK(search_set_hash(schema, randomset));
+        std::cout << "Raw file brute force" << std::endl;
+        BENCHMARK(search_set_raw(schema, randomset, "../data/schema/company.bin"));
+        std::cout << std::endl;
+
+        // range search
+        std::cout << "Range search" << std::endl << std::endl;
+        BENCHMARK(search_range(schema, lkey, hkey));
+        std::cout << "BPlus" << std::endl;
+        BENCHMARK(search_range_bplus(schema, lkey, hkey));
+        std::cout << "Hash" << std::endl;
+        BENCHMARK(search_range_hash(schema, lkey, hkey));
+        std::cout << "Raw file brute force" << std::endl;
+        BENCHMARK(search_range_raw(schema, lkey, hkey, "../data/schema/company.bin"));
+        std::cout << std::endl;      
+
+
+        break;
+        }
+      case OPERATION_JOIN:
+        {
+        std::cout << "mode: join" << std::endl;
         schema1 = schemadb.get_schema(schema_id);
         schema2 = schemadb.get_schema(schema_id2);  
+        schema1.set_scan_threads(threads);
+        schema2.set_scan_threads(threads);
         Join_Conditions jc;
         jc.rel1_filename=infile.c_str();
         jc.rel2_filename=infile2.c_str();
-        jc.field_name=field_name;        
-        jc.type=NATURAL_INNER;
-                
-        std::cout << "mode: natural inner join (nested)" << std::endl; 
-        jc.implementation=NESTED;       
-        BENCHMARK(schema1.join_natural_inner(schema2,jc));
-
-        /*std::cout << "mode: natural inner join (nested with existing index)" << std::endl; 
-        jc.implementation=NESTED_EXISTING_INDEX;
-        schema1.load_index(indexfile);
-        schema2.load_index(indexfile2);
-        BENCHMARK(schema1.join_natural_inner(schema2,jc));*/
-
-        std::cout << "mode: natural inner join (nested with new index)" << std::endl; 
-        jc.implementation=NESTED_NEW_INDEX;       
-        BENCHMARK(schema1.join_natural_inner(schema2,jc));
-
-        std::cout << "mode: natural inner join (merge)" << std::endl; 
-        jc.implementation=MERGE;       
-        BENCHMARK(schema1.join_natural_inner(schema2,jc));
-
-        std::cout << "mode: natural inner join (hash)" << std::endl; 
-        jc.implementation=HASH;       
-        BENCHMARK(schema1.join_natural_inner(schema2,jc));
-
-        std::cout << "mode: natural left join (hash)" << std::endl; 
-        jc.type=NATURAL_LEFT;
-        jc.implementation=HASH;       
-        BENCHMARK(schema1.join_natural_left(schema2,jc));
-
-        std::cout << "mode: natural right join (hash)" << std::endl; 
-        jc.type=NATURAL_RIGHT;
-        jc.implementation=HASH;       
-        BENCHMARK(schema1.join_natural_right(schema2,jc));
-
-        std::cout << "mode: natural full join (hash)" << std::endl; 
-        jc.type=NATURAL_FULL;
-        jc.implementation=HASH;       
-        BENCHMARK(schema1.join_natural_full(schema2,jc));
+        jc.field_name=field_name;
+        jc.type=join_tp;
+        jc.implementation=join_impl;
+        jc.op=join_op;
+        jc.band=band;
+        if(memory_budget){
+          jc.memory_budget=memory_budget;
+        }
+
+        schema1.join(schema2,jc);
 
-        std::cout << std::endl;      
         break;
-      }
+        }
+        case OPERATION_JOIN_BENCHMARK:{
+          schema1 = schemadb.get_schema(schema_id);
+          schema2 = schemadb.get_schema(schema_id2);  
+          schema1.set_scan_threads(threads);
+          schema2.set_scan_threads(threads);
+          Join_Conditions jc;
+          jc.rel1_filename=infile.c_str();
+          jc.rel2_filename=infile2.c_str();
+          jc.field_name=field_name;        
+          jc.type=NATURAL_INNER;
+          if(memory_budget){
+            jc.memory_budget=memory_budget;
+          }
+                
+          std::cout << "mode: natural inner join (nested)" << std::endl; 
+          jc.implementation=NESTED;       
+          BENCHMARK(schema1.join_natural_inner(schema2,jc));
+
+          std::cout << "mode: natural inner join (nested with existing index)" << std::endl; 
+          jc.implementation=NESTED_EXISTING_INDEX;
+          BENCHMARK(schema1.join_natural_inner(schema2,jc));
+
+          std::cout << "mode: natural inner join (nested with new index)" << std::endl; 
+          jc.implementation=NESTED_NEW_INDEX;       
+          BENCHMARK(schema1.join_natural_inner(schema2,jc));
+
+          std::cout << "mode: natural inner join (merge)" << std::endl; 
+          jc.implementation=MERGE;       
+          BENCHMARK(schema1.join_natural_inner(schema2,jc));
+
+          std::cout << "mode: natural inner join (hash)" << std::endl; 
+          jc.implementation=HASH;       
+          BENCHMARK(schema1.join_natural_inner(schema2,jc));
+
+          std::cout << "mode: natural inner join (grace hash)" << std::endl; 
+          jc.implementation=GRACE_HASH;       
+          BENCHMARK(schema1.join_natural_inner(schema2,jc));
+
+          std::cout << "mode: natural left join (hash)" << std::endl; 
+          jc.type=NATURAL_LEFT;
+          jc.implementation=HASH;       
+          BENCHMARK(schema1.join_natural_left(schema2,jc));
+
+          std::cout << "mode: natural right join (hash)" << std::endl; 
+          jc.type=NATURAL_RIGHT;
+          jc.implementation=HASH;       
+          BENCHMARK(schema1.join_natural_right(schema2,jc));
+
+          std::cout << "mode: natural full join (hash)" << std::endl; 
+          jc.type=NATURAL_FULL;
+          jc.implementation=HASH;       
+          BENCHMARK(schema1.join_natural_full(schema2,jc));
+
+          std::cout << std::endl;      
+          break;
+        }
+    }
+  }
+  catch(const std::exception& e) {
+    std::cout << std::endl << "error: " << e.what() << std::endl;
+    return EXIT_FAILURE;
   }
-
 
   return EXIT_SUCCESS;
 }
@@ -0,0 +1,157 @@
+#include "dictionary.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+struct DictionaryHeader {
+    int magic;
+    int column_count;
+    uint64_t fingerprint; // of the .bin the codes belong to
+};
+
+struct ColumnHeader {
+    int offset;
+    int width;
+    int count; // followed by count values of width bytes
+};
+
+}
+
+DictionaryColumn::DictionaryColumn(int offset, int width) :
+    offset(offset),
+    width(width),
+    count(0),
+    values(width, 0) {
+}
+
+int DictionaryColumn::get_offset() const {
+    return offset;
+}
+
+int DictionaryColumn::get_width() const {
+    return width;
+}
+
+std::size_t DictionaryColumn::size() const {
+    return count;
+}
+
+const char* DictionaryColumn::value(const char* code) const {
+    uint32_t c = decode_code(code);
+    return &values[std::min<std::size_t>(c, count) * width];
+}
+
+bool DictionaryColumn::find_code(const char* value, std::size_t length, char* code) const {
+    if(length > static_cast<std::size_t>(width) || memchr(value, '\0', length)) {
+        return false;
+    }
+    // Binary search over the padded values, a shorter value sorts first like
+    // its padding does.
+    std::size_t low = 0, high = count;
+    while(low < high) {
+        std::size_t middle = (low + high) / 2;
+        const char* candidate = &values[middle * width];
+        int cmp = memcmp(candidate, value, length);
+        if(cmp == 0 && length < static_cast<std::size_t>(width) && candidate[length] != '\0') {
+            cmp = 1;
+        }
+        if(cmp == 0) {
+            encode_code(middle, code);
+            return true;
+        }
+        if(cmp < 0) {
+            low = middle + 1;
+        }
+        else {
+            high = middle;
+        }
+    }
+    return false;
+}
+
+bool DictionaryColumn::same_values(const DictionaryColumn& other) const {
+    return this == &other || (width == other.width && values == other.values);
+}
+
+bool Dictionary::load(const std::string& dictionary_filename, uint64_t fingerprint) {
+    columns.clear();
+    FILE* dictionary_file = fopen(dictionary_filename.c_str(), "rb");
+    if(!dictionary_file) {
+        return false;
+    }
+
+    DictionaryHeader header;
+    bool valid = fread(&header, sizeof(header), 1, dictionary_file) && header.magic == DICTIONARY_MAGIC &&
+                 header.fingerprint == fingerprint;
+    for(int c = 0; valid && c < header.column_count; c++) {
+        ColumnHeader column_header;
+        valid = fread(&column_header, sizeof(column_header), 1, dictionary_file) &&
+                column_header.width > 0 && column_header.count >= 0;
+        if(valid) {
+            DictionaryColumn column(column_header.offset, column_header.width);
+            column.count = column_header.count;
+            column.values.assign((column.count + 1) * column.width, 0);
+            valid = fread(column.values.data(), column.width, column.count, dictionary_file) == column.count;
+            columns.push_back(column);
+        }
+    }
+    fclose(dictionary_file);
+
+    if(!valid) {
+        columns.clear();
+    }
+    return valid;
+}
+
+bool Dictionary::save(const std::string& dictionary_filename, uint64_t fingerprint) const {
+    FILE* dictionary_file = fopen(dictionary_filename.c_str(), "wb");
+    if(!dictionary_file) {
+        return false;
+    }
+    DictionaryHeader header = {DICTIONARY_MAGIC, static_cast<int>(columns.size()), fingerprint};
+    bool written = fwrite(&header, sizeof(header), 1, dictionary_file) == 1;
+    for(std::size_t c = 0; c < columns.size(); c++) {
+        const DictionaryColumn& column = columns[c];
+        ColumnHeader column_header = {column.offset, column.width, static_cast<int>(column.count)};
+        written = written && fwrite(&column_header, sizeof(column_header), 1, dictionary_file) == 1;
+        written = written && fwrite(column.values.data(), column.width, column.count, dictionary_file) == column.count;
+    }
+    return fclose(dictionary_file) == 0 && written;
+}
+
+bool Dictionary::empty() const {
+    return columns.empty();
+}
+
+const DictionaryColumn* Dictionary::find(int offset) const {
+    for(std::size_t c = 0; c < columns.size(); c++) {
+        if(columns[c].offset == offset) {
+            return &columns[c];
+        }
+    }
+    return NULL;
+}
+
+const DictionaryColumn& Dictionary::add_column(int offset, int width, std::vector<std::string> values) {
+    for(std::size_t i = 0; i < values.size(); i++) {
+        values[i].resize(strnlen(values[i].c_str(), std::min<std::size_t>(values[i].size(), width)));
+    }
+    std::sort(values.begin(), values.end());
+    values.erase(std::unique(values.begin(), values.end()), values.end());
+
+    DictionaryColumn column(offset, width);
+    column.count = values.size();
+    column.values.assign((column.count + 1) * width, 0);
+    for(std::size_t i = 0; i < values.size(); i++) {
+        memcpy(&column.values[i * width], values[i].data(), values[i].size());
+    }
+    columns.push_back(column);
+    return columns.back();
+}
+
+std::string dictionary_filename(const std::string& bin_filename) {
+    return bin_filename + ".dict";
+}
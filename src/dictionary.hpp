@@ -0,0 +1,75 @@
+#ifndef DICTIONARY_H
+#define DICTIONARY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Dictionary-encoded string columns ("dNNN" in a schema) store a CODE_SIZE
+// code in each row. The distinct values of each such column are kept sorted
+// in a side file next to the relation (<bin>.dict), so codes compare in the
+// same order as their values. The side file carries the fingerprint of the
+// .bin it was written for and is not loaded for any other version of it.
+//
+// A code is written as base-255 digits plus one, most significant first: it
+// never contains a NUL, so a code is also a valid fixed-width string and the
+// string comparisons, hashes and sorts of scans and joins work on it as is.
+const int CODE_SIZE = 4;
+const int DICTIONARY_MAGIC = 0x32434944; // "DIC2"
+
+inline void encode_code(uint32_t code, char* bytes) {
+    for(int i = CODE_SIZE - 1; i >= 0; i--) {
+        bytes[i] = static_cast<char>(1 + code % 255);
+        code /= 255;
+    }
+}
+
+inline uint32_t decode_code(const char* bytes) {
+    uint32_t code = 0;
+    for(int i = 0; i < CODE_SIZE; i++) {
+        code = code * 255 + (static_cast<unsigned char>(bytes[i]) - 1);
+    }
+    return code;
+}
+
+// The sorted values of one encoded column, each `width` bytes and NUL padded.
+class DictionaryColumn {
+public:
+    DictionaryColumn(int offset, int width);
+
+    int get_offset() const; // offset of the code from start of row (includes header)
+    int get_width() const;
+    std::size_t size() const;
+    const char* value(const char* code) const; // an empty value if code is not in the dictionary
+    bool find_code(const char* value, std::size_t length, char* code) const; // false if value is not in the dictionary
+    bool same_values(const DictionaryColumn& other) const; // true when codes of both mean the same values
+
+private:
+    friend class Dictionary;
+
+    int offset;
+    int width;
+    std::size_t count;
+    std::vector<char> values; // count values, then an empty one
+};
+
+// Every dictionary of a relation.
+class Dictionary {
+public:
+    // fingerprint is MappedRelation::get_fingerprint of the .bin.
+    bool load(const std::string& dictionary_filename, uint64_t fingerprint); // false if missing, invalid or stale
+    bool save(const std::string& dictionary_filename, uint64_t fingerprint) const; // false if the file cannot be written
+    bool empty() const;
+    const DictionaryColumn* find(int offset) const; // NULL if the field at offset is not encoded
+    // Adds the column at offset with the given distinct values, cut to width.
+    const DictionaryColumn& add_column(int offset, int width, std::vector<std::string> values);
+
+private:
+    std::vector<DictionaryColumn> columns;
+};
+
+// Where the dictionaries of a .bin file live: <bin>.dict
+std::string dictionary_filename(const std::string& bin_filename);
+
+#endif // DICTIONARY_H
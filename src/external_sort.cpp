@@ -0,0 +1,213 @@
+#include "external_sort.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+// Smallest read buffer given to a run while merging, bounds the merge fan-in.
+const std::size_t MIN_RUN_BUFFER = 64 * 1024;
+const std::size_t MIN_RUN_RECORDS = 1024;
+
+uint64_t key_prefix(const char* key, std::size_t key_size) {
+    uint64_t prefix = 0;
+    for(std::size_t i = 0; i < 8; i++) {
+        prefix = (prefix << 8) | (i < key_size ? static_cast<unsigned char>(key[i]) : 0);
+    }
+    return prefix;
+}
+
+}
+
+ExternalSorter::ExternalSorter(std::size_t key_size, std::size_t memory_budget) :
+    key_size(key_size),
+    memory_budget(memory_budget),
+    next_entry(0),
+    merging(false),
+    started(false) {
+    run_capacity = std::max(MIN_RUN_RECORDS, memory_budget / (record_size() + sizeof(Entry)));
+}
+
+ExternalSorter::~ExternalSorter() {
+    for(std::size_t i = 0; i < run_files.size(); i++) {
+        fclose(run_files[i]);
+    }
+}
+
+std::size_t ExternalSorter::record_size() const {
+    return key_size + sizeof(int);
+}
+
+void ExternalSorter::add(const char* key, int position) {
+    Entry entry = {key_prefix(key, key_size), static_cast<uint32_t>(entries.size())};
+    entries.push_back(entry);
+    records.insert(records.end(), key, key + key_size);
+    const char* bytes = reinterpret_cast<const char*>(&position);
+    records.insert(records.end(), bytes, bytes + sizeof(int));
+
+    if(entries.size() == run_capacity) {
+        spill();
+    }
+}
+
+void ExternalSorter::sort_buffer() {
+    const char* data = records.data();
+    const std::size_t size = record_size();
+    const std::size_t key_size = this->key_size;
+    std::sort(entries.begin(), entries.end(), [data, size, key_size](const Entry& a, const Entry& b) {
+        if(a.prefix != b.prefix) {
+            return a.prefix < b.prefix;
+        }
+        return memcmp(data + a.record * size, data + b.record * size, key_size) < 0;
+    });
+}
+
+void ExternalSorter::spill() {
+    sort_buffer();
+    FILE* file = tmpfile();
+    if(!file) {
+        throw std::runtime_error("could not create a temporary file for a sorted run");
+    }
+    for(std::size_t i = 0; i < entries.size(); i++) {
+        fwrite(&records[entries[i].record * record_size()], record_size(), 1, file);
+    }
+    rewind(file);
+    run_files.push_back(file);
+    run_counts.push_back(entries.size());
+    entries.clear();
+    records.clear();
+}
+
+void ExternalSorter::finish() {
+    if(run_files.empty()) {
+        sort_buffer();
+        return;
+    }
+    if(!entries.empty()) {
+        spill();
+    }
+    std::vector<char>().swap(records);
+    std::vector<Entry>().swap(entries);
+
+    // Merge the oldest runs until the rest can be merged in one pass.
+    const std::size_t fan_in = std::max<std::size_t>(2, memory_budget / MIN_RUN_BUFFER);
+    while(run_files.size() > fan_in) {
+        std::size_t count = 0;
+        for(std::size_t i = 0; i < fan_in; i++) {
+            count += run_counts[i];
+        }
+        FILE* merged = merge_runs(0, fan_in);
+        run_files.erase(run_files.begin(), run_files.begin() + fan_in);
+        run_counts.erase(run_counts.begin(), run_counts.begin() + fan_in);
+        run_files.push_back(merged);
+        run_counts.push_back(count);
+    }
+
+    open_runs(0, run_files.size());
+    merging = true;
+}
+
+FILE* ExternalSorter::merge_runs(std::size_t first, std::size_t count) {
+    FILE* file = tmpfile();
+    if(!file) {
+        throw std::runtime_error("could not create a temporary file for a sorted run");
+    }
+    open_runs(first, count);
+    for(const char* record = head(losers[0]); record; record = head(losers[0])) {
+        fwrite(record, record_size(), 1, file);
+        advance(losers[0]);
+        replay(losers[0]);
+    }
+    for(std::size_t i = first; i < first + count; i++) {
+        fclose(run_files[i]);
+    }
+    rewind(file);
+    return file;
+}
+
+void ExternalSorter::open_runs(std::size_t first, std::size_t count) {
+    const std::size_t buffer_records = std::max<std::size_t>(1, memory_budget / count / record_size());
+    runs.assign(count, Run());
+    for(std::size_t i = 0; i < count; i++) {
+        runs[i].file = run_files[first + i];
+        runs[i].remaining = run_counts[first + i];
+        runs[i].buffer.resize(std::min(buffer_records, runs[i].remaining) * record_size());
+        fill(runs[i]);
+    }
+
+    // Run `count` is a sentinel that beats every run, each real run displaces
+    // it on the way up.
+    losers.assign(count, count);
+    for(std::size_t i = count; i-- > 0;) {
+        replay(i);
+    }
+}
+
+bool ExternalSorter::fill(Run& run) {
+    std::size_t wanted = std::min(run.remaining, run.buffer.size() / record_size());
+    run.buffered = fread(run.buffer.data(), record_size(), wanted, run.file);
+    run.remaining = run.buffered < wanted ? 0 : run.remaining - wanted;
+    run.cursor = 0;
+    return run.buffered > 0;
+}
+
+const char* ExternalSorter::head(std::size_t run) const {
+    const Run& r = runs[run];
+    return r.cursor < r.buffered ? &r.buffer[r.cursor * record_size()] : NULL;
+}
+
+void ExternalSorter::advance(std::size_t run) {
+    Run& r = runs[run];
+    if(++r.cursor == r.buffered && r.remaining > 0) {
+        fill(r);
+    }
+}
+
+bool ExternalSorter::beats(std::size_t run1, std::size_t run2) const {
+    const std::size_t sentinel = runs.size();
+    if(run1 == sentinel || run2 == sentinel) {
+        return run1 == sentinel;
+    }
+    const char* head1 = head(run1);
+    const char* head2 = head(run2);
+    if(!head1 || !head2) {
+        return head1 != NULL;
+    }
+    int cmp = memcmp(head1, head2, key_size);
+    return cmp < 0 || (cmp == 0 && run1 < run2);
+}
+
+void ExternalSorter::replay(std::size_t run) {
+    const std::size_t count = runs.size();
+    for(std::size_t node = (run + count) / 2; node > 0; node /= 2) {
+        if(beats(losers[node], run)) {
+            std::swap(losers[node], run);
+        }
+    }
+    losers[0] = run;
+}
+
+bool ExternalSorter::next(const char** key, int* position) {
+    const char* record;
+    if(merging) {
+        if(started) {
+            advance(losers[0]);
+            replay(losers[0]);
+        }
+        started = true;
+        record = head(losers[0]);
+        if(!record) {
+            return false;
+        }
+    }
+    else {
+        if(next_entry == entries.size()) {
+            return false;
+        }
+        record = &records[entries[next_entry++].record * record_size()];
+    }
+    *key = record;
+    memcpy(position, record + key_size, sizeof(int));
+    return true;
+}
@@ -0,0 +1,73 @@
+#ifndef EXTERNAL_SORT_H
+#define EXTERNAL_SORT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+// Sorts (key, row position) records that may not fit in memory. Keys are
+// fixed-width byte strings compared with memcmp. Records are gathered into
+// runs of at most memory_budget bytes; each full run is sorted and spilled to
+// a temporary file, and the runs are then merged through a loser tree. When
+// everything fits in one run nothing touches the disk.
+class ExternalSorter {
+public:
+    ExternalSorter(std::size_t key_size, std::size_t memory_budget);
+    ~ExternalSorter();
+
+    void add(const char* key, int position); // key_size bytes
+    void finish(); // call once after the last add
+    // Next record in key order, false when there are no more. The key stays
+    // valid until the following call.
+    bool next(const char** key, int* position);
+
+private:
+    ExternalSorter(const ExternalSorter&);
+    ExternalSorter& operator=(const ExternalSorter&);
+
+    struct Entry {
+        uint64_t prefix; // first key bytes, big-endian, so most comparisons skip memcmp
+        uint32_t record;
+    };
+
+    // A sorted run read back from its file through a buffer.
+    struct Run {
+        FILE* file;
+        std::size_t remaining; // records not read from the file yet
+        std::vector<char> buffer;
+        std::size_t buffered; // records in the buffer
+        std::size_t cursor; // record of the buffer at the head of the run
+    };
+
+    std::size_t record_size() const;
+    void sort_buffer();
+    void spill();
+    FILE* merge_runs(std::size_t first, std::size_t count); // into a new run file
+    void open_runs(std::size_t first, std::size_t count);
+    bool fill(Run& run);
+    const char* head(std::size_t run) const; // NULL when the run is exhausted
+    void advance(std::size_t run);
+    bool beats(std::size_t run1, std::size_t run2) const;
+    void replay(std::size_t run);
+
+    std::size_t key_size;
+    std::size_t memory_budget;
+    std::size_t run_capacity; // records per run
+
+    std::vector<char> records;
+    std::vector<Entry> entries;
+    std::size_t next_entry; // when the result is the in-memory run
+
+    std::vector<FILE*> run_files;
+    std::vector<std::size_t> run_counts;
+
+    // Merge state: losers[0] is the current winner, losers[i] the loser of
+    // internal node i.
+    std::vector<Run> runs;
+    std::vector<std::size_t> losers;
+    bool merging;
+    bool started;
+};
+
+#endif // EXTERNAL_SORT_H
@@ -0,0 +1,218 @@
+#include "field_index.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <unistd.h>
+
+#include "external_sort.hpp"
+#include "hash_index.hpp"
+
+namespace {
+
+const int POSTINGS_MAGIC = 0x46494432;
+
+// Start of the postings file, ties the index to the relation it was built on.
+struct PostingsHeader {
+    int magic;
+    int row_count;
+    int row_size;
+    uint64_t fingerprint; // MappedRelation::get_fingerprint of the relation
+};
+
+std::string postings_filename(const std::string& index_filename) {
+    return index_filename + ".rows";
+}
+
+int index_key(const char* value, std::size_t length) {
+    return static_cast<int>(hash_bytes(value, length) >> 32);
+}
+
+// Keys as big-endian bytes with the sign bit flipped, so that the sorter's
+// memcmp order is the B+ tree's int order.
+void encode_key(int key, char* bytes) {
+    uint32_t biased = static_cast<uint32_t>(key) ^ 0x80000000u;
+    for(int i = 0; i < 4; i++) {
+        bytes[i] = static_cast<char>(biased >> (24 - 8 * i));
+    }
+}
+
+int decode_key(const char* bytes) {
+    uint32_t biased = 0;
+    for(int i = 0; i < 4; i++) {
+        biased = (biased << 8) | static_cast<unsigned char>(bytes[i]);
+    }
+    return static_cast<int>(biased ^ 0x80000000u);
+}
+
+class VectorSource : public bpt::record_source_t {
+public:
+    VectorSource(const std::vector<bpt::record_t>& records) : records(records), next_record(0) {}
+
+    bool next(bpt::record_t* record) {
+        if(next_record == records.size()) {
+            return false;
+        }
+        *record = records[next_record++];
+        return true;
+    }
+
+private:
+    const std::vector<bpt::record_t>& records;
+    std::size_t next_record;
+};
+
+}
+
+FieldIndex::FieldIndex() : tree(NULL), postings(NULL) {}
+
+FieldIndex::~FieldIndex() {
+    delete tree;
+    delete postings;
+}
+
+bool FieldIndex::build(const JoinColumn& column, const std::string& index_filename, std::size_t memory_budget) {
+    // The B+ tree assumes it can create its file, check before sorting.
+    FILE* tree_file = fopen(index_filename.c_str(), "wb");
+    FILE* postings_file = fopen(postings_filename(index_filename).c_str(), "wb");
+    if(!tree_file || !postings_file) {
+        if(tree_file) {
+            fclose(tree_file);
+        }
+        if(postings_file) {
+            fclose(postings_file);
+        }
+        return false;
+    }
+    fclose(tree_file);
+
+    ExternalSorter sorter(4, memory_budget);
+    char bytes[4];
+    for(std::size_t i = 0; i < column.rel.get_row_count(); i++) {
+        const char* value = join_value(column, i);
+        encode_key(index_key(value, strnlen(value, column.size)), bytes);
+        sorter.add(bytes, column.rel.get_position(i));
+    }
+    sorter.finish();
+
+    // One row list per distinct key: a count, then the positions.
+    PostingsHeader header = {POSTINGS_MAGIC, static_cast<int>(column.rel.get_row_count()), column.rel.get_row_size(),
+                             column.rel.get_fingerprint()};
+    fwrite(&header, sizeof(header), 1, postings_file);
+
+    std::vector<bpt::record_t> records;
+    std::vector<int> rows;
+    int offset = sizeof(header);
+    const char* key;
+    int position;
+    bool more = sorter.next(&key, &position);
+    while(more) {
+        int current = decode_key(key);
+        rows.clear();
+        do {
+            rows.push_back(position);
+            more = sorter.next(&key, &position);
+        } while(more && decode_key(key) == current);
+
+        bpt::record_t record;
+        record.key = bpt::key_t(current);
+        record.value = offset;
+        records.push_back(record);
+
+        int count = rows.size();
+        fwrite(&count, sizeof(int), 1, postings_file);
+        fwrite(rows.data(), sizeof(int), rows.size(), postings_file);
+        offset += (1 + rows.size()) * sizeof(int);
+    }
+    fclose(postings_file);
+
+    bpt::bplus_tree tree(index_filename.c_str(), true);
+    VectorSource source(records);
+    tree.bulk_load(source, records.size());
+    return true;
+}
+
+bool FieldIndex::open(const std::string& index_filename, const MappedRelation& rel) {
+    delete tree;
+    delete postings;
+    tree = NULL;
+    postings = NULL;
+
+    std::string rows_filename = postings_filename(index_filename);
+    // The B+ tree opens its file for update.
+    if(access(index_filename.c_str(), R_OK | W_OK) != 0 || access(rows_filename.c_str(), R_OK) != 0) {
+        return false;
+    }
+    postings = new MappedRelation(rows_filename, sizeof(int));
+    PostingsHeader header;
+    if(postings->get_size() < sizeof(header)) {
+        delete postings;
+        postings = NULL;
+        return false;
+    }
+    memcpy(&header, postings->get_data(), sizeof(header));
+    if(header.magic != POSTINGS_MAGIC || static_cast<std::size_t>(header.row_count) != rel.get_row_count() ||
+       header.row_size != rel.get_row_size() || header.fingerprint != rel.get_fingerprint()) {
+        delete postings;
+        postings = NULL;
+        return false;
+    }
+    tree = new bpt::bplus_tree(index_filename.c_str());
+    return true;
+}
+
+bool FieldIndex::is_open() const {
+    return tree != NULL;
+}
+
+void FieldIndex::lookup(const char* value, int size, const JoinColumn& column, std::vector<int>& positions) const {
+    std::size_t length = strnlen(value, size);
+    bpt::value_t offset;
+    if(tree->search(bpt::key_t(index_key(value, length)), &offset) != 0) {
+        return;
+    }
+
+    const char* list = postings->get_data() + offset;
+    int count;
+    memcpy(&count, list, sizeof(int));
+    for(int i = 1; i <= count; i++) {
+        int position;
+        memcpy(&position, list + i * sizeof(int), sizeof(int));
+        const char* field = join_value_at(column, position);
+        if(field) {
+            if(strnlen(field, column.size) == length && memcmp(field, value, length) == 0) {
+                positions.push_back(position);
+            }
+        }
+    }
+}
+
+std::string field_index_filename(const std::string& bin_filename, const std::string& field_name) {
+    return bin_filename + "." + field_name + ".findex";
+}
+
+void remove_field_indexes(const std::string& bin_filename) {
+    std::size_t slash = bin_filename.rfind('/');
+    std::string directory = slash == std::string::npos ? "." : bin_filename.substr(0, slash + 1);
+    std::string prefix = bin_filename.substr(slash == std::string::npos ? 0 : slash + 1) + ".";
+    DIR* dir = opendir(directory.c_str());
+    if(!dir) {
+        return;
+    }
+    const std::string suffixes[] = {".findex", postings_filename(".findex")};
+    std::vector<std::string> stale;
+    for(struct dirent* entry; (entry = readdir(dir)) != NULL;) {
+        std::string name = entry->d_name;
+        for(const std::string& suffix: suffixes) {
+            if(name.size() > prefix.size() + suffix.size() && name.compare(0, prefix.size(), prefix) == 0 &&
+               name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0) {
+                stale.push_back(name);
+            }
+        }
+    }
+    closedir(dir);
+    for(std::size_t i = 0; i < stale.size(); i++) {
+        unlink((slash == std::string::npos ? stale[i] : directory + stale[i]).c_str());
+    }
+}
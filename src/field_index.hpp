@@ -0,0 +1,45 @@
+#ifndef FIELD_INDEX_H
+#define FIELD_INDEX_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "BPlusTree/bpt.h"
+#include "join_key.hpp"
+#include "mapped_relation.hpp"
+
+// Secondary index on a string column of a .bin relation. A B+ tree maps the
+// 32-bit hash of each distinct value to a row list in a postings file next to
+// it (<index>.rows); lookups read that list and keep the rows whose field
+// really equals the value, so hash collisions only cost a comparison.
+class FieldIndex {
+public:
+    FieldIndex();
+    ~FieldIndex();
+
+    // Writes the index of column to index_filename, sorting within
+    // memory_budget. False if the index files cannot be created.
+    static bool build(const JoinColumn& column, const std::string& index_filename, std::size_t memory_budget);
+
+    // Opens an index built over rel, false if it is missing or was built
+    // over a different version of the file.
+    bool open(const std::string& index_filename, const MappedRelation& rel);
+    bool is_open() const;
+    // Appends the positions of the rows of column whose field equals value.
+    void lookup(const char* value, int size, const JoinColumn& column, std::vector<int>& positions) const;
+
+private:
+    FieldIndex(const FieldIndex&);
+    FieldIndex& operator=(const FieldIndex&);
+
+    bpt::bplus_tree* tree;
+    MappedRelation* postings;
+};
+
+// Where the index on field_name of a .bin file lives: <bin>.<field>.findex
+std::string field_index_filename(const std::string& bin_filename, const std::string& field_name);
+// Deletes every field index of a .bin file, for when it is rewritten.
+void remove_field_indexes(const std::string& bin_filename);
+
+#endif // FIELD_INDEX_H
@@ -0,0 +1,235 @@
+#include "grace_join.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#include "hash_index.hpp"
+#include "hash_join.hpp"
+
+namespace {
+
+const int FANOUT_BITS = 5;
+const std::size_t FANOUT = std::size_t(1) << FANOUT_BITS;
+const int MAX_DEPTH = 4;
+const std::size_t WRITE_BUFFER_SIZE = 64 * 1024;
+const std::size_t READ_RECORDS = 8192;
+// Table slot and hash kept per build record on top of the record itself.
+const std::size_t BUILD_OVERHEAD = 2 * sizeof(uint32_t) + sizeof(uint64_t);
+
+// Spilled records: 64-bit hash, row position, then the key.
+struct RecordLayout {
+    std::size_t key_size;
+
+    std::size_t size() const {
+        return sizeof(uint64_t) + sizeof(int) + key_size;
+    }
+    uint64_t hash(const char* record) const {
+        uint64_t hash;
+        memcpy(&hash, record, sizeof(hash));
+        return hash;
+    }
+    int position(const char* record) const {
+        int position;
+        memcpy(&position, record + sizeof(uint64_t), sizeof(position));
+        return position;
+    }
+    const char* key(const char* record) const {
+        return record + sizeof(uint64_t) + sizeof(int);
+    }
+};
+
+inline std::size_t partition_of(uint64_t hash, int depth) {
+    return (hash >> (64 - FANOUT_BITS * (depth + 1))) & (FANOUT - 1);
+}
+
+// FANOUT temporary files written through one buffer each.
+class Partitions {
+public:
+    Partitions() : files(FANOUT, NULL), counts(FANOUT, 0), buffers(FANOUT) {
+        for(std::size_t p = 0; p < FANOUT; p++) {
+            files[p] = tmpfile();
+            if(!files[p]) {
+                throw std::runtime_error("could not create a temporary file for a join partition");
+            }
+        }
+    }
+    ~Partitions() {
+        for(std::size_t p = 0; p < FANOUT; p++) {
+            fclose(files[p]);
+        }
+    }
+
+    void add(std::size_t p, const char* record, std::size_t size) {
+        buffers[p].insert(buffers[p].end(), record, record + size);
+        counts[p]++;
+        if(buffers[p].size() >= WRITE_BUFFER_SIZE) {
+            write(p);
+        }
+    }
+    // Writes out what is buffered and rewinds every file for reading.
+    void finish() {
+        for(std::size_t p = 0; p < FANOUT; p++) {
+            write(p);
+            std::vector<char>().swap(buffers[p]);
+            rewind(files[p]);
+        }
+    }
+    FILE* file(std::size_t p) const {
+        return files[p];
+    }
+    std::size_t count(std::size_t p) const {
+        return counts[p];
+    }
+
+private:
+    Partitions(const Partitions&);
+    Partitions& operator=(const Partitions&);
+
+    void write(std::size_t p) {
+        fwrite(buffers[p].data(), 1, buffers[p].size(), files[p]);
+        buffers[p].clear();
+    }
+
+    std::vector<FILE*> files;
+    std::vector<std::size_t> counts;
+    std::vector<std::vector<char>> buffers;
+};
+
+// Reads up to max_records records, returns how many were read.
+std::size_t read_records(FILE* file, const RecordLayout& layout, std::size_t max_records, std::vector<char>& buffer) {
+    buffer.resize(max_records * layout.size());
+    return fread(buffer.data(), layout.size(), max_records, file);
+}
+
+void partition_rows(const JoinKey& join_key, const RecordLayout& layout, Partitions& partitions) {
+    const MappedRelation& rel = join_key.columns[0].rel;
+    std::vector<char> record(layout.size());
+    char* key = record.data() + sizeof(uint64_t) + sizeof(int);
+    for(std::size_t i = 0; i < rel.get_row_count(); i++) {
+        uint64_t hash = hash_bytes(key, pack_join_key(join_key, i, key));
+        int position = rel.get_position(i);
+        memcpy(record.data(), &hash, sizeof(hash));
+        memcpy(record.data() + sizeof(uint64_t), &position, sizeof(position));
+        partitions.add(partition_of(hash, 0), record.data(), layout.size());
+    }
+    partitions.finish();
+}
+
+void repartition(FILE* file, const RecordLayout& layout, int depth, Partitions& partitions) {
+    std::vector<char> buffer;
+    for(std::size_t n; (n = read_records(file, layout, READ_RECORDS, buffer)) > 0;) {
+        for(std::size_t i = 0; i < n; i++) {
+            const char* record = &buffer[i * layout.size()];
+            partitions.add(partition_of(layout.hash(record), depth), record, layout.size());
+        }
+    }
+    partitions.finish();
+}
+
+// Joins one pair of partition files, both positioned at their start.
+void join_partition(FILE* inner, std::size_t inner_count, FILE* outer, std::size_t outer_count,
+                    const RecordLayout& layout, std::size_t memory_budget, int depth, JoinSink& sink) {
+    const std::size_t chunk_records = std::max<std::size_t>(1, memory_budget / (layout.size() + BUILD_OVERHEAD));
+
+    if(inner_count > chunk_records && depth + 1 < MAX_DEPTH) {
+        Partitions inner_partitions, outer_partitions;
+        repartition(inner, layout, depth + 1, inner_partitions);
+        repartition(outer, layout, depth + 1, outer_partitions);
+        for(std::size_t p = 0; p < FANOUT; p++) {
+            join_partition(inner_partitions.file(p), inner_partitions.count(p),
+                           outer_partitions.file(p), outer_partitions.count(p),
+                           layout, memory_budget, depth + 1, sink);
+        }
+        return;
+    }
+
+    // Build a table per chunk of the inner side and stream the outer side
+    // past it. With several chunks, outer rows that never matched are only
+    // known after the last one.
+    const bool single_chunk = inner_count <= chunk_records;
+    std::vector<bool> matched(single_chunk ? 0 : outer_count, false);
+    std::vector<char> build, probe;
+    std::vector<uint32_t> table;
+    const uint32_t empty = UINT32_MAX;
+
+    const std::size_t chunks = single_chunk ? 1 : (inner_count + chunk_records - 1) / chunk_records;
+    for(std::size_t c = 0; c < chunks; c++) {
+        std::size_t n = read_records(inner, layout, chunk_records, build);
+
+        std::size_t capacity = 16;
+        while(capacity < 2 * n) {
+            capacity *= 2;
+        }
+        const std::size_t mask = capacity - 1;
+        table.assign(capacity, empty);
+        for(std::size_t k = 0; k < n; k++) {
+            std::size_t slot = layout.hash(&build[k * layout.size()]) & mask;
+            while(table[slot] != empty) {
+                slot = (slot + 1) & mask;
+            }
+            table[slot] = k;
+        }
+
+        rewind(outer);
+        std::size_t row = 0;
+        for(std::size_t m; (m = read_records(outer, layout, READ_RECORDS, probe)) > 0;) {
+            for(std::size_t i = 0; i < m; i++, row++) {
+                const char* record = &probe[i * layout.size()];
+                const uint64_t hash = layout.hash(record);
+                bool found_joinable = false;
+                for(std::size_t slot = hash & mask; table[slot] != empty; slot = (slot + 1) & mask) {
+                    const char* candidate = &build[table[slot] * layout.size()];
+                    if(layout.hash(candidate) == hash &&
+                       memcmp(layout.key(candidate), layout.key(record), layout.key_size) == 0) {
+                        found_joinable = true;
+                        sink.consume(layout.position(record), layout.position(candidate));
+                    }
+                }
+                if(single_chunk) {
+                    if(!found_joinable) {
+                        sink.consume(layout.position(record), -1);
+                    }
+                }
+                else if(found_joinable) {
+                    matched[row] = true;
+                }
+            }
+        }
+    }
+
+    if(!single_chunk) {
+        rewind(outer);
+        std::size_t row = 0;
+        for(std::size_t m; (m = read_records(outer, layout, READ_RECORDS, probe)) > 0;) {
+            for(std::size_t i = 0; i < m; i++, row++) {
+                if(!matched[row]) {
+                    sink.consume(layout.position(&probe[i * layout.size()]), -1);
+                }
+            }
+        }
+    }
+}
+
+}
+
+void grace_hash_join_left(const JoinKey& outer, const JoinKey& inner, std::size_t memory_budget,
+                          unsigned threads, JoinSink& sink) {
+    RecordLayout layout = {static_cast<std::size_t>(outer.size)};
+    if(inner.columns[0].rel.get_row_count() * (layout.size() + BUILD_OVERHEAD) <= memory_budget) {
+        hash_join_left(outer, inner, threads, sink);
+        return;
+    }
+
+    Partitions inner_partitions, outer_partitions;
+    partition_rows(inner, layout, inner_partitions);
+    partition_rows(outer, layout, outer_partitions);
+    for(std::size_t p = 0; p < FANOUT; p++) {
+        join_partition(inner_partitions.file(p), inner_partitions.count(p),
+                       outer_partitions.file(p), outer_partitions.count(p),
+                       layout, memory_budget, 0, sink);
+    }
+}
@@ -0,0 +1,19 @@
+#ifndef GRACE_JOIN_H
+#define GRACE_JOIN_H
+
+#include <cstddef>
+
+#include "join_key.hpp"
+#include "join_sink.hpp"
+
+// Left outer hash equi-join on paired JoinKeys for build sides larger than
+// memory. When the inner relation's keys fit in memory_budget this is
+// hash_join_left. Otherwise both sides are partitioned by hash into temporary
+// files and partition pairs are joined one at a time; a partition still over
+// the budget is partitioned again on further hash bits, and past the last
+// level (one huge key) its inner side is joined in budget-sized chunks.
+// Pairs reach the sink as in hash_join_left.
+void grace_hash_join_left(const JoinKey& outer, const JoinKey& inner, std::size_t memory_budget,
+                          unsigned threads, JoinSink& sink);
+
+#endif // GRACE_JOIN_H
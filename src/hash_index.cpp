@@ -0,0 +1,146 @@
+#include "hash_index.hpp"
+
+#include <climits>
+#include <cstdio>
+
+const int HashIndex::EMPTY_KEY = INT_MIN;
+
+namespace {
+
+const std::size_t MIN_CAPACITY = 16;
+
+}
+
+HashIndex::HashIndex() {
+    clear();
+}
+
+void HashIndex::clear() {
+    keys.assign(MIN_CAPACITY, EMPTY_KEY);
+    offsets.assign(MIN_CAPACITY, -1);
+    count = 0;
+    shift = 32 - 4;
+    has_empty_key = false;
+    empty_key_offset = -1;
+}
+
+std::size_t HashIndex::slot_of(int key) const {
+    return hash_int(key) >> shift;
+}
+
+void HashIndex::reserve(std::size_t wanted) {
+    // Keep the load factor at or below one half.
+    std::size_t capacity = keys.size();
+    while(capacity < 2 * wanted) {
+        capacity *= 2;
+    }
+    if(capacity != keys.size()) {
+        rehash(capacity);
+    }
+}
+
+void HashIndex::rehash(std::size_t capacity) {
+    std::vector<int> old_keys(capacity, EMPTY_KEY);
+    std::vector<int> old_offsets(capacity, -1);
+    old_keys.swap(keys);
+    old_offsets.swap(offsets);
+
+    shift = 32;
+    for(std::size_t c = capacity; c > 1; c >>= 1) {
+        shift--;
+    }
+
+    const std::size_t mask = capacity - 1;
+    for(std::size_t i = 0; i < old_keys.size(); i++) {
+        if(old_keys[i] != EMPTY_KEY) {
+            std::size_t slot = slot_of(old_keys[i]);
+            while(keys[slot] != EMPTY_KEY) {
+                slot = (slot + 1) & mask;
+            }
+            keys[slot] = old_keys[i];
+            offsets[slot] = old_offsets[i];
+        }
+    }
+}
+
+void HashIndex::insert(int key, int offset) {
+    if(key == EMPTY_KEY) {
+        count += has_empty_key ? 0 : 1;
+        has_empty_key = true;
+        empty_key_offset = offset;
+        return;
+    }
+
+    reserve(count + 1);
+    const std::size_t mask = keys.size() - 1;
+    std::size_t slot = slot_of(key);
+    while(keys[slot] != EMPTY_KEY && keys[slot] != key) {
+        slot = (slot + 1) & mask;
+    }
+    if(keys[slot] == EMPTY_KEY) {
+        keys[slot] = key;
+        count++;
+    }
+    offsets[slot] = offset;
+}
+
+int HashIndex::find(int key) const {
+    if(key == EMPTY_KEY) {
+        return has_empty_key ? empty_key_offset : -1;
+    }
+
+    const std::size_t mask = keys.size() - 1;
+    for(std::size_t slot = slot_of(key); keys[slot] != EMPTY_KEY; slot = (slot + 1) & mask) {
+        if(keys[slot] == key) {
+            return offsets[slot];
+        }
+    }
+    return -1;
+}
+
+std::size_t HashIndex::size() const {
+    return count;
+}
+
+void HashIndex::load(const std::string& index_filename) {
+    clear();
+
+    FILE* index_file = fopen(index_filename.c_str(), "rb");
+    if(!index_file) {
+        return;
+    }
+    fseek(index_file, 0, SEEK_END);
+    std::size_t entries = ftell(index_file) / (2 * sizeof(int));
+    fseek(index_file, 0, SEEK_SET);
+
+    std::vector<int> pairs(2 * entries);
+    entries = fread(pairs.data(), 2 * sizeof(int), entries, index_file);
+    fclose(index_file);
+
+    reserve(entries);
+    for(std::size_t i = 0; i < entries; i++) {
+        insert(pairs[2 * i], pairs[2 * i + 1]);
+    }
+}
+
+bool HashIndex::save(const std::string& index_filename) const {
+    std::vector<int> pairs;
+    pairs.reserve(2 * count);
+    if(has_empty_key) {
+        pairs.push_back(EMPTY_KEY);
+        pairs.push_back(empty_key_offset);
+    }
+    for(std::size_t i = 0; i < keys.size(); i++) {
+        if(keys[i] != EMPTY_KEY) {
+            pairs.push_back(keys[i]);
+            pairs.push_back(offsets[i]);
+        }
+    }
+
+    FILE* index_file = fopen(index_filename.c_str(), "wb");
+    if(!index_file) {
+        return false;
+    }
+    bool written = fwrite(pairs.data(), sizeof(int), pairs.size(), index_file) == pairs.size();
+    return fclose(index_file) == 0 && written;
+}
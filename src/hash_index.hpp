@@ -0,0 +1,66 @@
+#ifndef HASH_INDEX_H
+#define HASH_INDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Fibonacci hashing: multiplying by 2^32 / phi spreads sequential keys over
+// the whole range, the top bits are the best mixed ones.
+inline uint32_t hash_int(int key) {
+    return static_cast<uint32_t>(key) * 2654435769u;
+}
+
+// 64-bit hash of a byte string, eight bytes at a time. Joins compare the
+// whole hash before touching the rows, so collisions have to stay rare.
+inline uint64_t hash_bytes(const char* data, std::size_t size) {
+    const uint64_t m = 0xff51afd7ed558ccdull;
+    uint64_t h = size * 0x9e3779b97f4a7c15ull;
+    for(; size >= 8; data += 8, size -= 8) {
+        uint64_t word;
+        memcpy(&word, data, 8);
+        h = (h ^ word) * m;
+        h ^= h >> 32;
+    }
+    if(size > 0) {
+        uint64_t word = 0;
+        memcpy(&word, data, size);
+        h = (h ^ word) * m;
+    }
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+// Flat open-addressing map from integer keys to row positions. Keys and
+// positions are kept in separate arrays and collisions probe linearly, so a
+// lookup scans consecutive keys instead of chasing list nodes.
+class HashIndex {
+public:
+    HashIndex();
+    void clear();
+    void reserve(std::size_t count);
+    void insert(int key, int offset); // replaces the offset of an existing key
+    int find(int key) const; // -1 if the key is not in the index
+    std::size_t size() const;
+    void load(const std::string& index_filename); // (int key, int offset) pairs, like create_index
+    bool save(const std::string& index_filename) const; // false if the file cannot be written
+
+private:
+    std::size_t slot_of(int key) const;
+    void rehash(std::size_t capacity);
+
+    // EMPTY_KEY marks a free slot, so that key itself is stored aside.
+    static const int EMPTY_KEY;
+    std::vector<int> keys;
+    std::vector<int> offsets;
+    std::size_t count;
+    int shift;
+    bool has_empty_key;
+    int empty_key_offset;
+};
+
+#endif // HASH_INDEX_H
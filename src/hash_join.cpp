@@ -0,0 +1,172 @@
+#include "hash_join.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+
+#include "bloom_filter.hpp"
+#include "hash_index.hpp"
+#include "parallel.hpp"
+
+namespace {
+
+// Inner rows per partition, small enough for a partition and its table to
+// stay in the L2 cache.
+const std::size_t PARTITION_ROWS = 16384;
+const int MAX_RADIX_BITS = 12;
+
+struct Tuple {
+    uint64_t hash;
+    int row; // in a table, the index of the key in its partition, -1 marking a free slot
+};
+
+// Partitions use the top bits of the hash, tables the bottom ones.
+inline std::size_t partition_of(uint64_t hash, int bits) {
+    return bits ? hash >> (64 - bits) : 0;
+}
+
+// Hashes the packed key of every row and scatters (hash, row) into 2^bits
+// partitions: each worker counts its rows per partition, then writes them to
+// its own slice of every partition, keeping row order inside a partition.
+// With a filter, the rows it rules out go to rejected instead, in row order.
+void partition(const JoinKey& join_key, int bits, unsigned threads, const BloomFilter* filter,
+               std::vector<Tuple>& tuples, std::vector<std::size_t>& bounds, std::vector<int>& rejected) {
+    const std::size_t rows = join_key.columns[0].rel.get_row_count();
+    const std::size_t partitions = std::size_t(1) << bits;
+    std::vector<uint64_t> hashes(rows);
+    std::vector<std::size_t> cursors(threads * partitions, 0);
+
+    run_parallel(threads, [&](unsigned t) {
+        std::size_t* counts = &cursors[t * partitions];
+        std::vector<char> key(join_key.size);
+        for(std::size_t i = rows * t / threads; i < rows * (t + 1) / threads; i++) {
+            hashes[i] = hash_bytes(key.data(), pack_join_key(join_key, i, key.data()));
+            if(!filter || filter->may_contain(hashes[i])) {
+                counts[partition_of(hashes[i], bits)]++;
+            }
+        }
+    });
+
+    bounds.assign(partitions + 1, 0);
+    std::size_t total = 0;
+    for(std::size_t p = 0; p < partitions; p++) {
+        bounds[p] = total;
+        for(unsigned t = 0; t < threads; t++) {
+            std::size_t count = cursors[t * partitions + p];
+            cursors[t * partitions + p] = total;
+            total += count;
+        }
+    }
+    bounds[partitions] = total;
+
+    tuples.resize(total);
+    run_parallel(threads, [&](unsigned t) {
+        std::size_t* next = &cursors[t * partitions];
+        for(std::size_t i = rows * t / threads; i < rows * (t + 1) / threads; i++) {
+            if(!filter || filter->may_contain(hashes[i])) {
+                Tuple tuple = {hashes[i], static_cast<int>(i)};
+                tuples[next[partition_of(hashes[i], bits)]++] = tuple;
+            }
+        }
+    });
+
+    if(filter) {
+        for(std::size_t i = 0; i < rows; i++) {
+            if(!filter->may_contain(hashes[i])) {
+                rejected.push_back(i);
+            }
+        }
+    }
+}
+
+}
+
+void hash_join_left(const JoinKey& outer, const JoinKey& inner, unsigned threads, JoinSink& sink) {
+    if(threads == 0) {
+        threads = default_thread_count();
+    }
+    const MappedRelation& rel1 = outer.columns[0].rel;
+    const MappedRelation& rel2 = inner.columns[0].rel;
+    const std::size_t key_size = outer.size;
+
+    int bits = 0;
+    while(bits < MAX_RADIX_BITS &&
+          ((rel2.get_row_count() >> bits) > PARTITION_ROWS || (1u << bits) < threads)) {
+        bits++;
+    }
+    const std::size_t partitions = std::size_t(1) << bits;
+
+    std::vector<Tuple> outer_tuples, inner_tuples;
+    std::vector<std::size_t> outer_bounds, inner_bounds;
+    std::vector<int> rejected;
+    partition(inner, bits, threads, NULL, inner_tuples, inner_bounds, rejected);
+
+    // The outer rows the inner keys' bloom filter rules out have no match,
+    // they skip partitioning and probing.
+    BloomFilter filter(inner_tuples.size());
+    for(std::size_t k = 0; k < inner_tuples.size(); k++) {
+        filter.add(inner_tuples[k].hash);
+    }
+    partition(outer, bits, threads, &filter, outer_tuples, outer_bounds, rejected);
+    for(std::size_t i = 0; i < rejected.size(); i++) {
+        sink.consume(rel1.get_position(rejected[i]), -1);
+    }
+
+    std::mutex sink_mutex;
+    std::atomic<std::size_t> cursor(0);
+    run_parallel(std::min<std::size_t>(threads, partitions), [&](unsigned) {
+        std::vector<Tuple> table;
+        std::vector<char> keys; // packed keys of the partition's inner rows
+        std::vector<char> key1(key_size);
+        std::vector<std::pair<int, int>> result;
+        for(std::size_t p = cursor++; p < partitions; p = cursor++) {
+            // Linear probing at load factor one half at most, duplicate
+            // values take consecutive slots.
+            const std::size_t first = inner_bounds[p];
+            const std::size_t count = inner_bounds[p + 1] - first;
+            std::size_t capacity = 16;
+            while(capacity < 2 * count) {
+                capacity *= 2;
+            }
+            const std::size_t mask = capacity - 1;
+            const Tuple empty = {0, -1};
+            table.assign(capacity, empty);
+            keys.resize(count * key_size);
+            for(std::size_t k = 0; k < count; k++) {
+                const Tuple& tuple = inner_tuples[first + k];
+                pack_join_key(inner, tuple.row, &keys[k * key_size]);
+                std::size_t slot = tuple.hash & mask;
+                while(table[slot].row != -1) {
+                    slot = (slot + 1) & mask;
+                }
+                table[slot].hash = tuple.hash;
+                table[slot].row = static_cast<int>(k);
+            }
+
+            result.clear();
+            for(std::size_t k = outer_bounds[p]; k < outer_bounds[p + 1]; k++) {
+                const Tuple& probe = outer_tuples[k];
+                pack_join_key(outer, probe.row, key1.data());
+                int position1 = rel1.get_position(probe.row);
+                bool found_joinable = false;
+                for(std::size_t slot = probe.hash & mask; table[slot].row != -1; slot = (slot + 1) & mask) {
+                    if(table[slot].hash == probe.hash &&
+                       memcmp(key1.data(), &keys[table[slot].row * key_size], key_size) == 0) {
+                        found_joinable = true;
+                        result.push_back(std::make_pair(position1, rel2.get_position(inner_tuples[first + table[slot].row].row)));
+                    }
+                }
+                if(!found_joinable) {
+                    result.push_back(std::make_pair(position1, -1));
+                }
+            }
+
+            std::lock_guard<std::mutex> lock(sink_mutex);
+            for(std::size_t i = 0; i < result.size(); i++) {
+                sink.consume(result[i].first, result[i].second);
+            }
+        }
+    });
+}
@@ -0,0 +1,18 @@
+#ifndef HASH_JOIN_H
+#define HASH_JOIN_H
+
+#include "join_key.hpp"
+#include "join_sink.hpp"
+
+// Left outer equi-join on two JoinKeys paired with pair_join_keys. Both sides
+// are radix partitioned on a 64-bit hash of the packed key, then each
+// partition packs the keys of its inner rows into a flat table and probes it
+// with the outer rows, partitions in parallel. Outer rows ruled out by a
+// bloom filter of the inner hashes skip partitioning and probing, and go to
+// the sink first as (outer position, -1). Each finished partition then hands
+// its (outer position, inner position) pairs to the sink, with (outer
+// position, -1) for outer rows without a match; the sink is only called by
+// one thread at a time. threads = 0 uses every core.
+void hash_join_left(const JoinKey& outer, const JoinKey& inner, unsigned threads, JoinSink& sink);
+
+#endif // HASH_JOIN_H
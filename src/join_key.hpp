@@ -0,0 +1,114 @@
+#ifndef JOIN_KEY_H
+#define JOIN_KEY_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "dictionary.hpp"
+#include "mapped_relation.hpp"
+
+// The column one side of a join is matched on. The field of an encoded
+// column holds a code; with a dictionary the column reads as the values
+// (size is then the value width), without one it reads as the codes.
+struct JoinColumn {
+    const MappedRelation& rel;
+    int offset; // offset from start of row (includes header)
+    int size;
+    const DictionaryColumn* dictionary;
+};
+
+inline const char* join_value(const JoinColumn& column, std::size_t row) {
+    const char* field = column.rel.get_field(row, column.offset);
+    return column.dictionary ? column.dictionary->value(field) : field;
+}
+
+inline const char* join_value_at(const JoinColumn& column, int pos) { // NULL if pos is not a row
+    const char* field = column.rel.get_field_at(pos, column.offset);
+    return field && column.dictionary ? column.dictionary->value(field) : field;
+}
+
+// Columns encoded with the same values compare their codes instead.
+inline void share_dictionary(JoinColumn& column1, JoinColumn& column2) {
+    if(column1.dictionary && column2.dictionary && column1.dictionary->same_values(*column2.dictionary)) {
+        column1.dictionary = column2.dictionary = NULL;
+        column1.size = column2.size = CODE_SIZE;
+    }
+}
+
+// Copies a string field into a key_size-byte key, zeroing everything after
+// the terminator. Keys of equal strings are equal bytes and memcmp orders
+// them like the strings, whatever the column widths on either side were.
+inline void copy_join_key(const char* value, int size, char* key, int key_size) {
+    std::size_t length = strnlen(value, size);
+    memcpy(key, value, length);
+    memset(key + length, 0, key_size - length);
+}
+
+// Ints are stored big-endian with the sign bit flipped, so memcmp orders
+// them like the numbers.
+inline void encode_int_key(int value, char* key) {
+    uint32_t bits = static_cast<uint32_t>(value) ^ 0x80000000u;
+    for(int i = 3; i >= 0; i--) {
+        key[i] = static_cast<char>(bits & 0xff);
+        bits >>= 8;
+    }
+}
+
+inline int decode_int_key(const char* key) {
+    uint32_t bits = 0;
+    for(int i = 0; i < 4; i++) {
+        bits = (bits << 8) | static_cast<unsigned char>(key[i]);
+    }
+    return static_cast<int>(bits ^ 0x80000000u);
+}
+
+// The columns one side of an equi-join is matched on, packed one after the
+// other into a fixed-width key per row: strings with copy_join_key at the
+// width of the wider side, ints with encode_int_key. Equal rows give equal
+// bytes on both sides, so a key is hashed and compared as a whole.
+struct JoinKey {
+    std::vector<JoinColumn> columns;
+    std::vector<bool> int_columns;
+    std::vector<int> widths; // bytes of each column in the key, set by pair_join_keys
+    int size;
+};
+
+// Gives both sides the same key layout, sharing dictionaries where it can.
+inline void pair_join_keys(JoinKey& key1, JoinKey& key2) {
+    key1.widths.clear();
+    key1.size = 0;
+    for(std::size_t c = 0; c < key1.columns.size(); c++) {
+        share_dictionary(key1.columns[c], key2.columns[c]);
+        int width = key1.int_columns[c] ? static_cast<int>(sizeof(int)) : std::max(key1.columns[c].size, key2.columns[c].size);
+        key1.widths.push_back(width);
+        key1.size += width;
+    }
+    key2.widths = key1.widths;
+    key2.size = key1.size;
+}
+
+// Returns the key length without the padding of its last column, which is
+// all a hash needs to read.
+inline std::size_t pack_join_key(const JoinKey& key, std::size_t row, char* out) {
+    std::size_t length = 0;
+    for(std::size_t c = 0; c < key.columns.size(); c++) {
+        const char* value = join_value(key.columns[c], row);
+        if(key.int_columns[c]) {
+            int number;
+            memcpy(&number, value, sizeof(int));
+            encode_int_key(number, out + length);
+            length += sizeof(int);
+        }
+        else {
+            std::size_t value_length = strnlen(value, key.columns[c].size);
+            memcpy(out + length, value, value_length);
+            memset(out + length + value_length, 0, key.widths[c] - value_length);
+            length += c + 1 < key.columns.size() ? key.widths[c] : value_length;
+        }
+    }
+    return length;
+}
+
+#endif // JOIN_KEY_H
@@ -0,0 +1,90 @@
+#ifndef JOIN_SINK_H
+#define JOIN_SINK_H
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// Receives joined rows as soon as a join algorithm finds them, as byte
+// positions in the two relations. -1 stands for the NULL row of an outer join.
+class JoinSink {
+public:
+    virtual ~JoinSink() {}
+    virtual void consume(int pos1, int pos2) = 0;
+};
+
+// Collects the pairs, for callers that want the whole result at once.
+class JoinCollector : public JoinSink {
+public:
+    explicit JoinCollector(std::vector<std::pair<int, int>>& pos_vector) : pos_vector(pos_vector) {}
+    void consume(int pos1, int pos2) {
+        pos_vector.push_back(std::make_pair(pos1, pos2));
+    }
+
+private:
+    std::vector<std::pair<int, int>>& pos_vector;
+};
+
+// Collects the rel1 positions of semi and anti joins.
+class RowCollector : public JoinSink {
+public:
+    explicit RowCollector(std::vector<int>& positions) : positions(positions) {}
+    void consume(int pos1, int) {
+        positions.push_back(pos1);
+    }
+
+private:
+    std::vector<int>& positions;
+};
+
+// Passes pairs on with the relations swapped, a right join runs as the left
+// join of the swapped relations.
+class SwappedJoinSink : public JoinSink {
+public:
+    explicit SwappedJoinSink(JoinSink& sink) : sink(sink) {}
+    void consume(int pos1, int pos2) {
+        sink.consume(pos2, pos1);
+    }
+
+private:
+    JoinSink& sink;
+};
+
+// Drops the rows of rel1 that found no match, a left join run through it
+// is an inner join.
+class InnerJoinSink : public JoinSink {
+public:
+    explicit InnerJoinSink(JoinSink& sink) : sink(sink) {}
+    void consume(int pos1, int pos2) {
+        if(pos2 != -1) {
+            sink.consume(pos1, pos2);
+        }
+    }
+
+private:
+    JoinSink& sink;
+};
+
+// Passes pairs on and marks the rows of rel2 they matched, so that a full
+// join can add the unmatched rows of rel2 after its left join.
+class MatchedRowsSink : public JoinSink {
+public:
+    MatchedRowsSink(JoinSink& sink, int row_size, std::size_t row_count) :
+        sink(sink), row_size(row_size), matched(row_count, false) {}
+    void consume(int pos1, int pos2) {
+        if(pos2 != -1) {
+            matched[pos2 / row_size] = true;
+        }
+        sink.consume(pos1, pos2);
+    }
+    bool is_matched(std::size_t row) const {
+        return matched[row];
+    }
+
+private:
+    JoinSink& sink;
+    int row_size;
+    std::vector<bool> matched;
+};
+
+#endif // JOIN_SINK_H
@@ -0,0 +1,310 @@
+#include "mapped_relation.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "block_codec.hpp"
+#include "compressed_layout.hpp"
+#include "hash_index.hpp"
+#include "pax_layout.hpp"
+
+namespace {
+
+// Bytes hashed at each end of the file for its fingerprint.
+const std::size_t FINGERPRINT_SAMPLE_SIZE = 4096;
+
+}
+
+MappedRelation::MappedRelation(const std::string& filename, int row_size) :
+    filename(filename),
+    fd(-1),
+    data(NULL),
+    file_size(0),
+    fingerprint(0),
+    row_size(row_size),
+    row_count(0),
+    pax(false),
+    rows_per_page(0),
+    page_size(0),
+    compressed(false),
+    rows_per_block(0),
+    decompressed(NULL) {
+    fd = open(filename.c_str(), O_RDONLY);
+    if(fd < 0) {
+        return;
+    }
+
+    struct stat st;
+    if(fstat(fd, &st) != 0 || st.st_size == 0) {
+        return;
+    }
+    file_size = st.st_size;
+
+    void* addr = mmap(NULL, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if(addr == MAP_FAILED) {
+        file_size = 0;
+        return;
+    }
+    data = static_cast<const char*>(addr);
+    madvise(addr, file_size, MADV_SEQUENTIAL);
+    const uint64_t stamp[3] = {file_size, static_cast<uint64_t>(st.st_mtim.tv_sec), static_cast<uint64_t>(st.st_mtim.tv_nsec)};
+    const std::size_t sample = std::min<std::size_t>(file_size, FINGERPRINT_SAMPLE_SIZE);
+    fingerprint = hash_bytes(reinterpret_cast<const char*>(stamp), sizeof(stamp));
+    fingerprint = fingerprint * 31 + hash_bytes(data, sample);
+    fingerprint = fingerprint * 31 + hash_bytes(data + file_size - sample, sample);
+    dictionary.load(dictionary_filename(filename), fingerprint);
+
+    if(read_pax_header() || read_compressed_header()) {
+        return;
+    }
+    // A trailing partial row is ignored, like the fread loops did.
+    row_count = row_size > 0 ? file_size / row_size : 0;
+}
+
+MappedRelation::~MappedRelation() {
+    if(decompressed) {
+        munmap(decompressed, row_count * row_size);
+    }
+    if(data) {
+        munmap(const_cast<char*>(data), file_size);
+    }
+    if(fd >= 0) {
+        close(fd);
+    }
+}
+
+bool MappedRelation::read_pax_header() {
+    PaxHeader header;
+    if(file_size < static_cast<std::size_t>(PAX_HEADER_SIZE)) {
+        return false;
+    }
+    memcpy(&header, data, sizeof(header));
+    if(header.magic != PAX_MAGIC || header.row_size != row_size || header.rows_per_page <= 0 ||
+       header.column_count <= 0 || sizeof(header) + header.column_count * sizeof(int) > static_cast<std::size_t>(PAX_HEADER_SIZE)) {
+        return false;
+    }
+
+    std::vector<int> widths(header.column_count);
+    memcpy(widths.data(), data + sizeof(header), header.column_count * sizeof(int));
+    int start = 0;
+    for(int c = 0; c < header.column_count; c++) {
+        if(widths[c] <= 0) {
+            return false;
+        }
+        start += widths[c];
+    }
+    if(start != row_size) {
+        return false;
+    }
+
+    column_width = widths;
+    rows_per_page = header.rows_per_page;
+    column_of.resize(row_size);
+    start = 0;
+    std::size_t minipage = 0;
+    for(int c = 0; c < header.column_count; c++) {
+        column_start.push_back(start);
+        minipage_offset.push_back(minipage);
+        std::fill(column_of.begin() + start, column_of.begin() + start + widths[c], c);
+        start += widths[c];
+        minipage += rows_per_page * widths[c];
+    }
+    page_size = minipage;
+
+    pax = true;
+    row_count = header.row_count;
+    // Never trust a row count the pages do not back.
+    std::size_t pages = (file_size - PAX_HEADER_SIZE) / page_size;
+    row_count = std::min(row_count, pages * rows_per_page);
+    return true;
+}
+
+bool MappedRelation::read_compressed_header() {
+    CompressedHeader header;
+    if(file_size < sizeof(header)) {
+        return false;
+    }
+    memcpy(&header, data, sizeof(header));
+    if(header.magic != COMPRESSED_MAGIC || header.row_size != row_size || header.rows_per_block <= 0 ||
+       header.row_count < 0 || header.block_count != (static_cast<int64_t>(header.row_count) + header.rows_per_block - 1) / header.rows_per_block) {
+        return false;
+    }
+    const std::size_t directory_end = sizeof(header) + (header.block_count + 1) * sizeof(uint64_t);
+    if(directory_end > file_size) {
+        return false;
+    }
+    std::vector<uint64_t> offsets(header.block_count + 1);
+    memcpy(offsets.data(), data + sizeof(header), offsets.size() * sizeof(uint64_t));
+    if(offsets[0] < directory_end || offsets.back() > file_size) {
+        return false;
+    }
+    for(int b = 0; b < header.block_count; b++) {
+        if(offsets[b] > offsets[b + 1]) {
+            return false;
+        }
+    }
+
+    compressed = true;
+    block_offsets.swap(offsets);
+    rows_per_block = header.rows_per_block;
+    block_ready.reset(new std::once_flag[header.block_count]);
+    // Address space for the whole relation, pages are only backed once a
+    // block is decompressed into them.
+    if(header.row_count > 0) {
+        void* addr = mmap(NULL, static_cast<std::size_t>(header.row_count) * row_size, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if(addr != MAP_FAILED) {
+            decompressed = static_cast<char*>(addr);
+            row_count = header.row_count;
+        }
+    }
+    return true;
+}
+
+std::size_t MappedRelation::decompress(std::size_t block, char* out) const {
+    const std::size_t first = block * rows_per_block;
+    const std::size_t rows = std::min(rows_per_block, row_count - first);
+    const std::size_t size = rows * row_size;
+    const char* stored = data + block_offsets[block];
+    const std::size_t stored_size = block_offsets[block + 1] - block_offsets[block];
+    if(stored_size == size) {
+        memcpy(out, stored, size);
+    }
+    else if(!decompress_block(stored, stored_size, out, size)) {
+        throw std::runtime_error("block " + std::to_string(block) + " of " + filename + " is damaged");
+    }
+    return rows;
+}
+
+const char* MappedRelation::get_block(std::size_t block) const {
+    char* out = decompressed + block * rows_per_block * row_size;
+    std::call_once(block_ready[block], [this, block, out]() {
+        decompress(block, out);
+    });
+    return out;
+}
+
+bool MappedRelation::is_open() const {
+    return fd >= 0;
+}
+
+bool MappedRelation::is_pax() const {
+    return pax;
+}
+
+bool MappedRelation::is_compressed() const {
+    return compressed;
+}
+
+std::size_t MappedRelation::get_row_count() const {
+    return row_count;
+}
+
+int MappedRelation::get_row_size() const {
+    return row_size;
+}
+
+int MappedRelation::get_position(std::size_t row) const {
+    return row * row_size;
+}
+
+bool MappedRelation::has_position(int pos) const {
+    return pos >= 0 && pos % row_size == 0 && static_cast<std::size_t>(pos / row_size) < row_count;
+}
+
+const char* MappedRelation::get_field(std::size_t row, int offset) const {
+    if(compressed) {
+        return get_block(row / rows_per_block) + (row % rows_per_block) * row_size + offset;
+    }
+    if(!pax) {
+        return data + row * row_size + offset;
+    }
+    const int c = column_of[offset];
+    return data + PAX_HEADER_SIZE + (row / rows_per_page) * page_size + minipage_offset[c] +
+           (row % rows_per_page) * column_width[c] + (offset - column_start[c]);
+}
+
+const char* MappedRelation::get_field_at(int pos, int offset) const {
+    return has_position(pos) ? get_field(pos / row_size, offset) : NULL;
+}
+
+std::size_t MappedRelation::get_field_run(std::size_t row, int offset, const char** field, std::size_t* stride, std::vector<char>& buffer) const {
+    if(compressed) {
+        const char* rows;
+        std::size_t count = read_rows(row, buffer, &rows);
+        *field = rows + offset;
+        *stride = row_size;
+        return count;
+    }
+    *field = get_field(row, offset);
+    if(!pax) {
+        *stride = row_size;
+        return row_count - row;
+    }
+    *stride = column_width[column_of[offset]];
+    return std::min(rows_per_page - row % rows_per_page, row_count - row);
+}
+
+const char* MappedRelation::read_row(std::size_t row, char* buffer) const {
+    if(compressed) {
+        return get_field(row, 0);
+    }
+    if(!pax) {
+        return data + row * row_size;
+    }
+    for(std::size_t c = 0; c < column_width.size(); c++) {
+        memcpy(buffer + column_start[c], get_field(row, column_start[c]), column_width[c]);
+    }
+    return buffer;
+}
+
+const char* MappedRelation::read_row_at(int pos, char* buffer) const {
+    return has_position(pos) ? read_row(pos / row_size, buffer) : NULL;
+}
+
+std::size_t MappedRelation::read_rows(std::size_t row, std::vector<char>& buffer, const char** rows) const {
+    if(compressed) {
+        buffer.resize(std::max(buffer.size(), rows_per_block * row_size));
+        const std::size_t block = row / rows_per_block;
+        const std::size_t first = row % rows_per_block;
+        std::size_t count = decompress(block, buffer.data()) - first;
+        *rows = buffer.data() + first * row_size;
+        return count;
+    }
+    if(pax) {
+        const std::size_t count = std::min(rows_per_page - row % rows_per_page, row_count - row);
+        buffer.resize(std::max(buffer.size(), count * row_size));
+        for(std::size_t r = 0; r < count; r++) {
+            read_row(row + r, &buffer[r * row_size]);
+        }
+        *rows = buffer.data();
+        return count;
+    }
+    *rows = data + row * row_size;
+    return row_count - row;
+}
+
+const Dictionary& MappedRelation::get_dictionary() const {
+    return dictionary;
+}
+
+const char* MappedRelation::get_data() const {
+    return data;
+}
+
+std::size_t MappedRelation::get_size() const {
+    return file_size;
+}
+
+const std::string& MappedRelation::get_filename() const {
+    return filename;
+}
+
+uint64_t MappedRelation::get_fingerprint() const {
+    return fingerprint;
+}
@@ -0,0 +1,93 @@
+#ifndef MAPPED_RELATION_H
+#define MAPPED_RELATION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "dictionary.hpp"
+
+// Read-only view of a .bin relation. The whole file is mapped once and rows
+// are addressed by a fixed stride (header + data), so scans touch memory
+// instead of issuing one fseek/fread pair per row. Files in the PAX layout
+// (see pax_layout.hpp) or compressed (see compressed_layout.hpp) are
+// recognised by their header and read through the same row positions and
+// field offsets. Random reads of a compressed file decompress its block into
+// a private copy of the relation, once; scans decompress into their own
+// buffer instead. Reading a block that does not decode throws
+// std::runtime_error. The dictionaries of encoded columns
+// (see dictionary.hpp) are loaded along with the file, if they were written
+// for this version of it.
+class MappedRelation {
+public:
+    MappedRelation(const std::string& filename, int row_size);
+    ~MappedRelation();
+
+    bool is_open() const;
+    bool is_pax() const;
+    bool is_compressed() const;
+    std::size_t get_row_count() const;
+    int get_row_size() const;
+    int get_position(std::size_t row) const; // byte offset of the row in a row-major file
+    const char* get_field(std::size_t row, int offset) const; // offset from start of row (includes header)
+    const char* get_field_at(int pos, int offset) const; // NULL if pos is not a row of the file
+    // Rows from `row` on whose field at offset lies `stride` bytes apart,
+    // *field points at the first one. Compressed blocks are decompressed
+    // into buffer, which the caller reuses from run to run.
+    std::size_t get_field_run(std::size_t row, int offset, const char** field, std::size_t* stride, std::vector<char>& buffer) const;
+    // The whole row, assembled into buffer (row_size bytes) when the layout
+    // splits it.
+    const char* read_row(std::size_t row, char* buffer) const;
+    const char* read_row_at(int pos, char* buffer) const; // NULL if pos is not a row of the file
+    // Rows from `row` on laid out row-major at *rows, assembled or
+    // decompressed into buffer when the layout requires it.
+    std::size_t read_rows(std::size_t row, std::vector<char>& buffer, const char** rows) const;
+    const Dictionary& get_dictionary() const; // empty if no column is encoded or <bin>.dict is stale
+    const std::string& get_filename() const;
+    const char* get_data() const;
+    std::size_t get_size() const; // size of the file in bytes
+    // Changes whenever the file is rewritten: its size, modification time
+    // and a hash of its first and last bytes. Side files built from the
+    // relation store it to detect that they went stale.
+    uint64_t get_fingerprint() const;
+
+private:
+    MappedRelation(const MappedRelation&);
+    MappedRelation& operator=(const MappedRelation&);
+
+    bool read_pax_header();
+    bool read_compressed_header();
+    std::size_t decompress(std::size_t block, char* out) const; // rows of the block, throws if it is damaged
+    const char* get_block(std::size_t block) const; // in the decompressed copy
+    bool has_position(int pos) const;
+
+    std::string filename;
+    int fd;
+    const char* data;
+    std::size_t file_size;
+    uint64_t fingerprint;
+    int row_size;
+    std::size_t row_count;
+    Dictionary dictionary;
+
+    // PAX layout only.
+    bool pax;
+    std::size_t rows_per_page;
+    std::size_t page_size;
+    std::vector<int> column_start; // offset of each column in the row
+    std::vector<int> column_width;
+    std::vector<std::size_t> minipage_offset; // offset of each column in a page
+    std::vector<int> column_of; // column of each byte of the row
+
+    // Compressed files only.
+    bool compressed;
+    std::size_t rows_per_block;
+    std::vector<uint64_t> block_offsets; // block_count + 1
+    char* decompressed; // row-major copy, blocks are filled on first use
+    std::unique_ptr<std::once_flag[]> block_ready;
+};
+
+#endif // MAPPED_RELATION_H
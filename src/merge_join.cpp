@@ -0,0 +1,77 @@
+#include "merge_join.hpp"
+
+#include <cstring>
+#include <vector>
+
+#include "bloom_filter.hpp"
+#include "external_sort.hpp"
+#include "hash_index.hpp"
+
+namespace {
+
+void sort_inner(const JoinKey& join_key, ExternalSorter& sorter, BloomFilter& filter) {
+    const MappedRelation& rel = join_key.columns[0].rel;
+    std::vector<char> key(join_key.size);
+    for(std::size_t i = 0; i < rel.get_row_count(); i++) {
+        filter.add(hash_bytes(key.data(), pack_join_key(join_key, i, key.data())));
+        sorter.add(key.data(), rel.get_position(i));
+    }
+    sorter.finish();
+}
+
+// Outer rows the filter rules out go to the sink at once instead of the
+// sorter.
+void sort_outer(const JoinKey& join_key, ExternalSorter& sorter, const BloomFilter& filter, JoinSink& sink) {
+    const MappedRelation& rel = join_key.columns[0].rel;
+    std::vector<char> key(join_key.size);
+    for(std::size_t i = 0; i < rel.get_row_count(); i++) {
+        if(filter.may_contain(hash_bytes(key.data(), pack_join_key(join_key, i, key.data())))) {
+            sorter.add(key.data(), rel.get_position(i));
+        }
+        else {
+            sink.consume(rel.get_position(i), -1);
+        }
+    }
+    sorter.finish();
+}
+
+}
+
+void merge_join_left(const JoinKey& outer, const JoinKey& inner, std::size_t memory_budget, JoinSink& sink) {
+    const int key_size = outer.size;
+    ExternalSorter sorted1(key_size, memory_budget / 2);
+    ExternalSorter sorted2(key_size, memory_budget / 2);
+    BloomFilter filter(inner.columns[0].rel.get_row_count());
+    sort_inner(inner, sorted2, filter);
+    sort_outer(outer, sorted1, filter, sink);
+
+    // Inner rows sharing the key of the last outer row, reused while the
+    // following outer rows have the same key.
+    std::vector<char> group_key(key_size);
+    std::vector<int> group;
+
+    const char* key1;
+    const char* key2;
+    int pos1, pos2;
+    bool has_inner = sorted2.next(&key2, &pos2);
+    while(sorted1.next(&key1, &pos1)) {
+        if(group.empty() || memcmp(key1, group_key.data(), key_size) != 0) {
+            group.clear();
+            while(has_inner && memcmp(key2, key1, key_size) < 0) {
+                has_inner = sorted2.next(&key2, &pos2);
+            }
+            while(has_inner && memcmp(key2, key1, key_size) == 0) {
+                group.push_back(pos2);
+                has_inner = sorted2.next(&key2, &pos2);
+            }
+            memcpy(group_key.data(), key1, key_size);
+        }
+
+        if(group.empty()) {
+            sink.consume(pos1, -1);
+        }
+        for(std::size_t j = 0; j < group.size(); j++) {
+            sink.consume(pos1, group[j]);
+        }
+    }
+}
@@ -0,0 +1,20 @@
+#ifndef MERGE_JOIN_H
+#define MERGE_JOIN_H
+
+#include <cstddef>
+
+#include "join_key.hpp"
+#include "join_sink.hpp"
+
+// Left outer sort-merge equi-join on the packed keys of two JoinKeys paired
+// with pair_join_keys. Each side's (key, row position) records go through an
+// ExternalSorter with half of memory_budget, so relations larger than memory
+// spill sorted runs to temporary files, and the two sorted streams are
+// merged. The inner side is sorted first, into a bloom filter of its keys
+// as well, and the outer rows the filter rules out are not sorted at all:
+// they go to the sink as (outer position, -1) while the outer side is read.
+// The other pairs follow in key order, with (outer position, -1) for the
+// remaining outer rows without a match.
+void merge_join_left(const JoinKey& outer, const JoinKey& inner, std::size_t memory_budget, JoinSink& sink);
+
+#endif // MERGE_JOIN_H
@@ -0,0 +1,160 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+inline unsigned default_thread_count() {
+    unsigned threads = std::thread::hardware_concurrency();
+    return threads ? threads : 1;
+}
+
+// Runs f(worker) for worker in [0, threads), the calling thread is worker 0.
+// The first exception thrown by any worker is rethrown once all have finished.
+template <typename F>
+void run_parallel(unsigned threads, F f) {
+    std::exception_ptr error;
+    std::mutex mutex;
+    auto run = [&](unsigned worker) {
+        try {
+            f(worker);
+        } catch(...) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if(!error) {
+                error = std::current_exception();
+            }
+        }
+    };
+    std::vector<std::thread> workers;
+    for(unsigned worker = 1; worker < threads; worker++) {
+        workers.push_back(std::thread(run, worker));
+    }
+    run(0u);
+    for(auto& thread: workers) {
+        thread.join();
+    }
+    if(error) {
+        std::rethrow_exception(error);
+    }
+}
+
+// Rows handed out per claim of a morsel-driven scan.
+const std::size_t MORSEL_ROWS = 16384;
+// Morsels buffered per worker before their results are consumed.
+const std::size_t MORSELS_PER_WORKER = 4;
+
+// Morsel-driven scan over rows [0, rows). A pool of workers, started once
+// per scan, claims MORSEL_ROWS-row morsels from a shared cursor and calls
+// produce(begin, end, result) with a fresh Result for each one; the calling
+// thread passes the results to consume(result) in row order as they
+// complete. Results wait in a ring of threads * MORSELS_PER_WORKER slots,
+// and a worker only claims a morsel once its slot is free, so a slow
+// consumer holds back the scan instead of letting the output pile up.
+// An exception from produce or consume stops the scan and is rethrown once
+// the workers have finished. threads = 0 uses every core.
+template <typename Result, typename Produce, typename Consume>
+void scan_morsels(std::size_t rows, unsigned threads, Produce produce, Consume consume) {
+    if(threads == 0) {
+        threads = default_thread_count();
+    }
+    const std::size_t morsels = (rows + MORSEL_ROWS - 1) / MORSEL_ROWS;
+    if(threads == 1 || morsels <= 1) {
+        for(std::size_t m = 0; m < morsels; m++) {
+            Result result;
+            produce(m * MORSEL_ROWS, std::min((m + 1) * MORSEL_ROWS, rows), result);
+            consume(result);
+        }
+        return;
+    }
+
+    const std::size_t window = threads * MORSELS_PER_WORKER;
+    std::vector<Result> results(window);
+    std::vector<char> ready(window, 0);
+    std::size_t claimed = 0; // morsels handed out
+    std::size_t consumed = 0; // morsels passed to consume
+    std::exception_ptr error; // first failure, stops the scan
+    std::mutex mutex;
+    std::condition_variable slot_free, result_ready;
+    // Called with mutex held: records the failure and stops further claims.
+    auto fail = [&](std::exception_ptr e) {
+        if(!error) {
+            error = e;
+        }
+        claimed = morsels;
+    };
+
+    std::vector<std::thread> workers;
+    for(unsigned worker = 0; worker < std::min<std::size_t>(threads, morsels); worker++) {
+        workers.push_back(std::thread([&]() {
+            for(;;) {
+                std::size_t m;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    slot_free.wait(lock, [&]() { return claimed == morsels || claimed < consumed + window; });
+                    if(claimed == morsels) {
+                        return;
+                    }
+                    m = claimed++;
+                }
+                if(m + 1 == morsels) {
+                    slot_free.notify_all(); // the idle workers can stop
+                }
+                Result& result = results[m % window];
+                try {
+                    result = Result();
+                    std::size_t begin = m * MORSEL_ROWS;
+                    produce(begin, std::min(begin + MORSEL_ROWS, rows), result);
+                } catch(...) {
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        fail(std::current_exception());
+                    }
+                    slot_free.notify_all();
+                    result_ready.notify_one();
+                    return;
+                }
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    ready[m % window] = 1;
+                }
+                result_ready.notify_one();
+            }
+        }));
+    }
+
+    try {
+        for(std::size_t m = 0; m < morsels; m++) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                result_ready.wait(lock, [&]() { return ready[m % window] != 0 || error; });
+                if(error) {
+                    break;
+                }
+            }
+            consume(results[m % window]);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                ready[m % window] = 0;
+                consumed++;
+            }
+            slot_free.notify_one();
+        }
+    } catch(...) {
+        std::lock_guard<std::mutex> lock(mutex);
+        fail(std::current_exception());
+    }
+    slot_free.notify_all();
+    for(auto& thread: workers) {
+        thread.join();
+    }
+    if(error) {
+        std::rethrow_exception(error);
+    }
+}
+
+#endif // PARALLEL_H
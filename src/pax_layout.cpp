@@ -0,0 +1,43 @@
+#include "pax_layout.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include "mapped_relation.hpp"
+
+bool write_pax(const MappedRelation& rows, const std::vector<int>& column_widths, const std::string& pax_filename) {
+    const int row_size = rows.get_row_size();
+    // Small relations get one page that just fits them.
+    const int rows_per_page = std::max<int>(1, std::min<std::size_t>(PAX_PAGE_SIZE / row_size, rows.get_row_count()));
+
+    std::vector<char> header(PAX_HEADER_SIZE, 0);
+    PaxHeader pax = {PAX_MAGIC, row_size, static_cast<int>(rows.get_row_count()), rows_per_page,
+                     static_cast<int>(column_widths.size())};
+    memcpy(header.data(), &pax, sizeof(pax));
+    memcpy(header.data() + sizeof(pax), column_widths.data(), column_widths.size() * sizeof(int));
+
+    FILE* pax_file = fopen(pax_filename.c_str(), "wb");
+    if(!pax_file) {
+        return false;
+    }
+    fwrite(header.data(), 1, header.size(), pax_file);
+
+    std::vector<char> page(static_cast<std::size_t>(rows_per_page) * row_size);
+    for(std::size_t first = 0; first < rows.get_row_count(); first += rows_per_page) {
+        const std::size_t count = std::min<std::size_t>(rows_per_page, rows.get_row_count() - first);
+        std::fill(page.begin(), page.end(), 0);
+        char* minipage = page.data();
+        int column_start = 0;
+        for(std::size_t c = 0; c < column_widths.size(); c++) {
+            for(std::size_t r = 0; r < count; r++) {
+                memcpy(minipage + r * column_widths[c], rows.get_field(first + r, column_start), column_widths[c]);
+            }
+            minipage += static_cast<std::size_t>(rows_per_page) * column_widths[c];
+            column_start += column_widths[c];
+        }
+        fwrite(page.data(), 1, page.size(), pax_file);
+    }
+    fclose(pax_file);
+    return true;
+}
@@ -0,0 +1,30 @@
+#ifndef PAX_LAYOUT_H
+#define PAX_LAYOUT_H
+
+#include <string>
+#include <vector>
+
+class MappedRelation;
+
+// PAX files store each page of rows column by column: a page holds
+// rows_per_page rows as one minipage per column (the three header fields
+// count as columns), so scanning a column reads only that column's bytes.
+// A header page with the column widths comes first. Rows keep their
+// row-major positions, row * row_size, so indexes and joins work unchanged.
+const int PAX_MAGIC = 0x31584150; // "PAX1"
+const int PAX_HEADER_SIZE = 4096;
+const int PAX_PAGE_SIZE = 64 * 1024; // rows per page are fitted to this
+
+struct PaxHeader {
+    int magic;
+    int row_size;
+    int row_count;
+    int rows_per_page;
+    int column_count; // followed by column_count widths
+};
+
+// Rewrites a row-major relation in the PAX layout, false if the file cannot
+// be created.
+bool write_pax(const MappedRelation& rows, const std::vector<int>& column_widths, const std::string& pax_filename);
+
+#endif // PAX_LAYOUT_H
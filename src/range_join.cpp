@@ -0,0 +1,341 @@
+#include "range_join.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#include <unistd.h>
+
+#include "external_sort.hpp"
+
+namespace {
+
+// The key of row i, in the byte order of memcmp.
+void make_key(const JoinColumn& column, std::size_t i, bool int_keys, int key_size, char* key) {
+    const char* value = join_value(column, i);
+    if(int_keys) {
+        int number;
+        memcpy(&number, value, sizeof(int));
+        encode_int_key(number, key);
+    }
+    else {
+        copy_join_key(value, column.size, key, key_size);
+    }
+}
+
+void sort_column(const JoinColumn& column, bool int_keys, int key_size, ExternalSorter& sorter) {
+    std::vector<char> key(key_size);
+    for(std::size_t i = 0; i < column.rel.get_row_count(); i++) {
+        make_key(column, i, int_keys, key_size, key.data());
+        sorter.add(key.data(), column.rel.get_position(i));
+    }
+    sorter.finish();
+}
+
+// One end of the range of inner keys an outer key reaches.
+struct Bound {
+    bool unbounded;
+    bool open; // the key itself is out of range
+    std::vector<char> key;
+};
+
+// Bytes of a spilled window read back at a time.
+const std::size_t WINDOW_READ_SIZE = 1 << 20;
+
+// Inner rows in key order, from the first one still in range, as (key,
+// position) records. Rows are numbered in the order they were pushed. The
+// oldest ones move to a temporary file whenever the records in memory
+// outgrow memory_limit, and are read back from it for every outer row: with
+// lt, le, gt or ge most of the inner side can be in range at once.
+class Window {
+public:
+    Window(int key_size, std::size_t memory_limit) :
+        key_size(key_size),
+        record_size(key_size + sizeof(int)),
+        memory_limit(std::max(memory_limit, WINDOW_READ_SIZE)),
+        file(NULL),
+        file_first(0),
+        spilled(0),
+        memory_first(0),
+        first(0),
+        count(0),
+        front_row(0),
+        front(record_size) {}
+    ~Window() {
+        if(file) {
+            fclose(file);
+        }
+    }
+
+    bool empty() const {
+        return first == count;
+    }
+
+    const char* front_key() {
+        if(first >= memory_first) {
+            return &records[(first - memory_first) * record_size];
+        }
+        if(front_row != first + 1) {
+            read(first - file_first, 1, front.data());
+            front_row = first + 1;
+        }
+        return front.data();
+    }
+
+    void push_back(const char* key, int position) {
+        records.insert(records.end(), key, key + key_size);
+        const char* bytes = reinterpret_cast<const char*>(&position);
+        records.insert(records.end(), bytes, bytes + sizeof(int));
+        count++;
+        if(records.size() > memory_limit) {
+            spill();
+        }
+    }
+
+    void pop_front() {
+        first++;
+        if(first >= memory_first) {
+            spilled = 0; // the file only holds dropped rows, it is reused
+            // Dropped rows are reclaimed once they are half of the buffer.
+            if((first - memory_first) * 2 > count - memory_first) {
+                records.erase(records.begin(), records.begin() + (first - memory_first) * record_size);
+                memory_first = first;
+            }
+        }
+    }
+
+    // Calls f(position) for the rows in the window, in key order.
+    template <typename F>
+    void for_each(F f) {
+        for(std::size_t row = first; row < memory_first;) {
+            std::size_t rows = std::min(memory_first - row, std::max<std::size_t>(1, WINDOW_READ_SIZE / record_size));
+            chunk.resize(rows * record_size);
+            read(row - file_first, rows, chunk.data());
+            for(std::size_t i = 0; i < rows; i++) {
+                f(position_of(&chunk[i * record_size]));
+            }
+            row += rows;
+        }
+        for(std::size_t row = std::max(first, memory_first); row < count; row++) {
+            f(position_of(&records[(row - memory_first) * record_size]));
+        }
+    }
+
+private:
+    Window(const Window&);
+    Window& operator=(const Window&);
+
+    int position_of(const char* record) const {
+        int position;
+        memcpy(&position, record + key_size, sizeof(int));
+        return position;
+    }
+
+    void spill() {
+        if(first > memory_first) {
+            records.erase(records.begin(), records.begin() + (first - memory_first) * record_size);
+            memory_first = first;
+        }
+        if(!file) {
+            file = tmpfile();
+            if(!file) {
+                throw std::runtime_error("could not create a temporary file for a join window");
+            }
+        }
+        if(spilled == 0) {
+            file_first = memory_first;
+        }
+        const char* data = records.data();
+        std::size_t size = records.size();
+        off_t offset = static_cast<off_t>(spilled) * record_size;
+        while(size > 0) {
+            ssize_t written = pwrite(fileno(file), data, size, offset);
+            if(written <= 0) {
+                throw std::runtime_error("could not write a temporary file for a join window");
+            }
+            data += written;
+            size -= written;
+            offset += written;
+        }
+        spilled += count - memory_first;
+        memory_first = count;
+        records.clear();
+    }
+
+    // Spilled records [row, row + rows) of the file into out.
+    void read(std::size_t row, std::size_t rows, char* out) const {
+        std::size_t size = rows * record_size;
+        off_t offset = static_cast<off_t>(row) * record_size;
+        while(size > 0) {
+            ssize_t got = pread(fileno(file), out, size, offset);
+            if(got <= 0) {
+                throw std::runtime_error("could not read a temporary file for a join window");
+            }
+            out += got;
+            size -= got;
+            offset += got;
+        }
+    }
+
+    int key_size;
+    std::size_t record_size;
+    std::size_t memory_limit; // bytes of records kept in memory
+    FILE* file;
+    std::size_t file_first; // row of the first record in the file
+    std::size_t spilled; // records in the file
+    std::vector<char> records; // rows [memory_first, count)
+    std::size_t memory_first;
+    std::size_t first; // first row still in range
+    std::size_t count; // rows pushed
+    std::size_t front_row; // row + 1 of the record in front
+    std::vector<char> front;
+    std::vector<char> chunk; // spilled records read back
+};
+
+}
+
+join_operator mirror_operator(join_operator op) {
+    switch(op) {
+        case LESS:
+            return GREATER;
+        case LESS_EQUAL:
+            return GREATER_EQUAL;
+        case GREATER:
+            return LESS;
+        case GREATER_EQUAL:
+            return LESS_EQUAL;
+        default:
+            return op;
+    }
+}
+
+void range_join_left(const JoinColumn& outer, const JoinColumn& inner, bool int_keys, join_operator op, int band,
+                     std::size_t memory_budget, JoinSink& sink) {
+    // Each sorter and the window get a third of the budget.
+    const int key_size = int_keys ? sizeof(int) : std::max(outer.size, inner.size);
+    ExternalSorter sorted1(key_size, memory_budget / 3);
+    ExternalSorter sorted2(key_size, memory_budget / 3);
+    sort_column(outer, int_keys, key_size, sorted1);
+    sort_column(inner, int_keys, key_size, sorted2);
+
+    Bound low = {op == GREATER || op == GREATER_EQUAL, op == LESS, std::vector<char>(key_size)};
+    Bound high = {op == LESS || op == LESS_EQUAL, op == GREATER, std::vector<char>(key_size)};
+
+    Window window(key_size, memory_budget / 3);
+    const char* key1;
+    const char* key2;
+    int position1, position2;
+    bool more2 = sorted2.next(&key2, &position2);
+    while(sorted1.next(&key1, &position1)) {
+        if(op == BAND) {
+            const int64_t value = decode_int_key(key1);
+            encode_int_key(std::max<int64_t>(INT_MIN, value - band), low.key.data());
+            encode_int_key(std::min<int64_t>(INT_MAX, value + band), high.key.data());
+        }
+        else {
+            memcpy(low.key.data(), key1, key_size);
+            memcpy(high.key.data(), key1, key_size);
+        }
+
+        // Take in the inner rows up to the upper bound...
+        while(more2) {
+            if(!high.unbounded) {
+                int cmp = memcmp(key2, high.key.data(), key_size);
+                if(cmp > 0 || (cmp == 0 && high.open)) {
+                    break;
+                }
+            }
+            window.push_back(key2, position2);
+            more2 = sorted2.next(&key2, &position2);
+        }
+        // ...and drop those below the lower bound, later outer rows do not
+        // reach them either.
+        while(!low.unbounded && !window.empty()) {
+            int cmp = memcmp(window.front_key(), low.key.data(), key_size);
+            if(cmp > 0 || (cmp == 0 && !low.open)) {
+                break;
+            }
+            window.pop_front();
+        }
+
+        if(window.empty()) {
+            sink.consume(position1, -1);
+        }
+        window.for_each([&](int position2) {
+            sink.consume(position1, position2);
+        });
+    }
+}
+
+void range_semi_join(const JoinColumn& outer, const JoinColumn& inner, bool int_keys, join_operator op, int band,
+                     bool anti, std::size_t memory_budget, JoinSink& sink) {
+    const int key_size = int_keys ? sizeof(int) : std::max(outer.size, inner.size);
+    std::vector<char> key(key_size);
+
+    if(op == LESS || op == LESS_EQUAL || op == GREATER || op == GREATER_EQUAL) {
+        // A one-sided condition holds for some inner row if it holds for the
+        // largest inner key (lt, le) or the smallest one (gt, ge).
+        const bool largest = op == LESS || op == LESS_EQUAL;
+        std::vector<char> extreme(key_size);
+        bool any = false;
+        for(std::size_t i = 0; i < inner.rel.get_row_count(); i++) {
+            make_key(inner, i, int_keys, key_size, key.data());
+            int cmp = memcmp(key.data(), extreme.data(), key_size);
+            if(!any || (largest ? cmp > 0 : cmp < 0)) {
+                memcpy(extreme.data(), key.data(), key_size);
+                any = true;
+            }
+        }
+        for(std::size_t i = 0; i < outer.rel.get_row_count(); i++) {
+            bool match = false;
+            if(any) {
+                make_key(outer, i, int_keys, key_size, key.data());
+                int cmp = memcmp(key.data(), extreme.data(), key_size);
+                match = op == LESS ? cmp < 0 : op == LESS_EQUAL ? cmp <= 0 : op == GREATER ? cmp > 0 : cmp >= 0;
+            }
+            if(match != anti) {
+                sink.consume(outer.rel.get_position(i), -1);
+            }
+        }
+        return;
+    }
+
+    // Equality and bands sweep the sorted sides like range_join_left, but
+    // only keep the last inner key up to the upper bound: the window is
+    // empty when that key is below the lower bound.
+    ExternalSorter sorted1(key_size, memory_budget / 2);
+    ExternalSorter sorted2(key_size, memory_budget / 2);
+    sort_column(outer, int_keys, key_size, sorted1);
+    sort_column(inner, int_keys, key_size, sorted2);
+
+    std::vector<char> low(key_size), high(key_size), last(key_size);
+    bool any = false;
+    const char* key1;
+    const char* key2;
+    int position1, position2;
+    bool more2 = sorted2.next(&key2, &position2);
+    while(sorted1.next(&key1, &position1)) {
+        if(op == BAND) {
+            const int64_t value = decode_int_key(key1);
+            encode_int_key(std::max<int64_t>(INT_MIN, value - band), low.data());
+            encode_int_key(std::min<int64_t>(INT_MAX, value + band), high.data());
+        }
+        else {
+            memcpy(low.data(), key1, key_size);
+            memcpy(high.data(), key1, key_size);
+        }
+        while(more2 && memcmp(key2, high.data(), key_size) <= 0) {
+            memcpy(last.data(), key2, key_size);
+            any = true;
+            more2 = sorted2.next(&key2, &position2);
+        }
+        bool match = any && memcmp(last.data(), low.data(), key_size) >= 0;
+        if(match != anti) {
+            sink.consume(position1, -1);
+        }
+    }
+}
@@ -0,0 +1,45 @@
+#ifndef RANGE_JOIN_H
+#define RANGE_JOIN_H
+
+#include <cstddef>
+
+#include "join_key.hpp"
+#include "join_sink.hpp"
+
+// How the field of rel1 compares to the field of rel2 in a join condition.
+enum join_operator{
+    EQUAL,
+    LESS, // rel1.x < rel2.x
+    LESS_EQUAL,
+    GREATER,
+    GREATER_EQUAL,
+    BAND // rel2.x BETWEEN rel1.x - band AND rel1.x + band, int columns only
+};
+
+// The operator with the relations swapped, for right joins.
+join_operator mirror_operator(join_operator op);
+
+// Left outer join on `outer op inner`, over int columns (int_keys) or
+// string columns. Both sides are sorted with an ExternalSorter on a third of
+// memory_budget each and swept together: for the outer rows in key order,
+// the inner rows in range form a window that only moves forward, so each
+// inner row is read once and kept only while some outer row may reach it.
+// With lt, le, gt and ge that can be the whole inner side; the window keeps
+// up to the last third of memory_budget in memory and spills the rest to a
+// temporary file, read back for every outer row. Pairs reach the sink in
+// outer key order, with (outer position, -1) for outer rows without a
+// match.
+void range_join_left(const JoinColumn& outer, const JoinColumn& inner, bool int_keys, join_operator op, int band,
+                     std::size_t memory_budget, JoinSink& sink);
+
+// Semi-join (anti = false) or anti-join (anti = true) on `outer op inner`:
+// the outer rows that have, or lack, an inner row in range, each once as
+// (outer position, -1). Only whether the range is empty matters, so no pair
+// is listed. lt, le, gt and ge compare each outer key with the largest or
+// smallest inner key, in row order. Equality and bands sweep both sides
+// sorted like range_join_left, in outer key order, remembering only the
+// last inner key taken in.
+void range_semi_join(const JoinColumn& outer, const JoinColumn& inner, bool int_keys, join_operator op, int band,
+                     bool anti, std::size_t memory_budget, JoinSink& sink);
+
+#endif // RANGE_JOIN_H
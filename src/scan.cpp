@@ -0,0 +1,94 @@
+#include "scan.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+#if defined(__AVX2__)
+const std::size_t VECTOR_SIZE = 32;
+
+// Compares the first `size` bytes, reading whole vectors of both sides.
+inline bool vector_equal(const char* field, const char* pattern, std::size_t size) {
+    std::size_t i = 0;
+    for(; i + VECTOR_SIZE <= size; i += VECTOR_SIZE) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(field + i));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pattern + i));
+        if(static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, b))) != 0xffffffffu) {
+            return false;
+        }
+    }
+    if(i < size) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(field + i));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pattern + i));
+        unsigned wanted = (1u << (size - i)) - 1;
+        unsigned equal = _mm256_movemask_epi8(_mm256_cmpeq_epi8(a, b));
+        return (equal & wanted) == wanted;
+    }
+    return true;
+}
+#elif defined(__SSE2__)
+const std::size_t VECTOR_SIZE = 16;
+
+inline bool vector_equal(const char* field, const char* pattern, std::size_t size) {
+    std::size_t i = 0;
+    for(; i + VECTOR_SIZE <= size; i += VECTOR_SIZE) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(field + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pattern + i));
+        if(_mm_movemask_epi8(_mm_cmpeq_epi8(a, b)) != 0xffff) {
+            return false;
+        }
+    }
+    if(i < size) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(field + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pattern + i));
+        int wanted = (1 << (size - i)) - 1;
+        return (_mm_movemask_epi8(_mm_cmpeq_epi8(a, b)) & wanted) == wanted;
+    }
+    return true;
+}
+#else
+const std::size_t VECTOR_SIZE = 1;
+
+inline bool vector_equal(const char* field, const char* pattern, std::size_t size) {
+    return memcmp(field, pattern, size) == 0;
+}
+#endif
+
+}
+
+void scan_field_equal(const char* fields, std::size_t rows, std::size_t stride, std::size_t width,
+                      const std::string& needle, int first_row, std::vector<int>& matches) {
+    if(rows == 0 || needle.size() > width) {
+        return;
+    }
+
+    // The needle and its terminator, padded to whole vectors.
+    const std::size_t size = std::min(needle.size() + 1, width);
+    const std::size_t padded = (size + VECTOR_SIZE - 1) / VECTOR_SIZE * VECTOR_SIZE;
+    std::vector<char> pattern(padded, 0);
+    memcpy(pattern.data(), needle.data(), needle.size());
+    const char first_byte = pattern[0];
+
+    // Whole vector reads past the field stay inside the next row, so only
+    // the last row of the block has to be compared byte by byte.
+    std::size_t vector_rows = (padded <= stride + width) ? rows - 1 : 0;
+
+    const char* field = fields;
+    for(std::size_t i = 0; i < vector_rows; i++, field += stride) {
+        if(*field == first_byte && vector_equal(field, pattern.data(), size)) {
+            matches.push_back(first_row + i);
+        }
+    }
+    for(std::size_t i = vector_rows; i < rows; i++, field += stride) {
+        if(*field == first_byte && memcmp(field, pattern.data(), size) == 0) {
+            matches.push_back(first_row + i);
+        }
+    }
+}
@@ -0,0 +1,16 @@
+#ifndef SCAN_H
+#define SCAN_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Equality scan over a block of fixed-width fields. `fields` points at the
+// field of the first row and each following row is `stride` bytes further.
+// A field equals `needle` like a C string would: same bytes up to the end of
+// the needle, then a NUL or the end of the column. Matching rows are
+// appended to `matches` as first_row + their index in the block.
+void scan_field_equal(const char* fields, std::size_t rows, std::size_t stride, std::size_t width,
+                      const std::string& needle, int first_row, std::vector<int>& matches);
+
+#endif // SCAN_H
@@ -1,11 +1,34 @@
 #include "schema.hpp"
 
 #include <algorithm>
+#include <atomic>
+#include <cerrno>
 #include <cstdio>
+#include <cstring>
 #include <ctime>
 #include <fstream>
 #include <iostream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
 #include <unordered_map>
+#include <unordered_set>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "block_nested_join.hpp"
+#include "compressed_layout.hpp"
+#include "field_index.hpp"
+#include "grace_join.hpp"
+#include "hash_join.hpp"
+#include "mapped_relation.hpp"
+#include "merge_join.hpp"
+#include "pax_layout.hpp"
+#include "parallel.hpp"
+#include "range_join.hpp"
+#include "scan.hpp"
+#include "zone_map.hpp"
 
 // Format Www Mmm dd hh:mm:ss yyyy
 std::string get_current_timestamp() {
@@ -16,6 +39,12 @@ std::string get_current_timestamp() {
     return asctime(timeinfo);
 }
 
+// Fixed-width fields are not always NUL-terminated (a value that fills the
+// whole column has no terminator), so never read past the column.
+static std::string field_to_string(const char* field, int size) {
+    return std::string(field, strnlen(field, size));
+}
+
 Schema::Schema(){
     compute_size();
     compute_header_size();
@@ -42,14 +71,7 @@ Schema::Schema(const std::string& filename, int id) :
         metadata.push_back(std::make_pair(datatype, column));
         column_index.insert(std::make_pair(column,i));
         column_offset.insert(std::make_pair(column,offset));
-        int column_size=0;
-        if(datatype=="int"){
-            column_size=sizeof(int);
-        }
-        else{
-            column_size=atoi(datatype.c_str()+1);  // Assumes string   
-        }
-        offset+=column_size;
+        offset+=get_column_size(i);
         i++;
     }
 
@@ -62,14 +84,100 @@ Schema::Schema(const std::string& filename, int id) :
 void Schema::compute_size() {
     size = 0;
 
-    for(const auto& data: metadata) {
-        if (data.first[0] == 'i') {
-            size += sizeof(int);
+    for(unsigned i = 0; i < metadata.size(); i++) {
+        size += get_column_size(i);
+    }
+}
+
+int Schema::get_column_size(int index) const {
+    if (metadata[index].first[0] == 'i') {
+        return sizeof(int);
+    }
+    if (is_encoded(index)) {
+        return CODE_SIZE;
+    }
+    // ASSUMES: string.
+    return atoi(metadata[index].first.c_str() + 1);
+}
+
+int Schema::get_value_size(int index) const {
+    if (is_encoded(index)) {
+        return atoi(metadata[index].first.c_str() + 1);
+    }
+    return get_column_size(index);
+}
+
+bool Schema::is_int(int index) const {
+    return metadata[index].first[0] == 'i';
+}
+
+bool Schema::is_encoded(int index) const {
+    return metadata[index].first[0] == 'd';
+}
+
+const DictionaryColumn* Schema::get_dictionary(const MappedRelation& rel, int index) const {
+    if(!rel.is_open()) {
+        return NULL;
+    }
+    // Without its dictionary a code would be read as a 4-byte string.
+    const DictionaryColumn* values = rel.get_dictionary().find(get_header_size() + column_offset.at(metadata[index].second));
+    if(!values || values->get_width() != get_value_size(index)) {
+        throw std::runtime_error(dictionary_filename(rel.get_filename()) + " is missing or does not match " + rel.get_filename());
+    }
+    return values;
+}
+
+void Schema::check_dictionaries(const MappedRelation& rel) const {
+    for(unsigned i = 0; i < metadata.size(); i++) {
+        if(is_encoded(i)) {
+            get_dictionary(rel, i);
+        }
+    }
+}
+
+std::vector<ZoneField> Schema::get_zone_fields() const {
+    std::vector<ZoneField> fields;
+    ZoneField key = {0, sizeof(int), ZONE_INT};
+    fields.push_back(key);
+    for(unsigned i = 0; i < metadata.size(); i++) {
+        ZoneField field = {get_header_size() + column_offset.at(metadata[i].second), get_column_size(i),
+                           metadata[i].first[0] == 'i' ? ZONE_INT : ZONE_STRING};
+        fields.push_back(field);
+    }
+    return fields;
+}
+
+std::vector<int> Schema::get_field_widths() const {
+    std::vector<int> widths;
+    widths.push_back(sizeof(int));
+    widths.push_back(static_cast<int>(TIMESTAMP_SIZE));
+    widths.push_back(sizeof(int));
+    for(unsigned i = 0; i < metadata.size(); i++) {
+        widths.push_back(get_column_size(i));
+    }
+    return widths;
+}
+
+void Schema::print_row(const char* data, const Dictionary& dictionary, std::ostream& out) const {
+    int offset = get_header_size();
+    for(unsigned i = 0; i < metadata.size(); i++) {
+        if (metadata[i].first[0] == 'i') {
+            int int_token;
+            memcpy(&int_token, data, sizeof(int));
+            out<<int_token;
+        }
+        else if (is_encoded(i)) {
+            const DictionaryColumn* values = dictionary.find(offset);
+            if(values) {
+                out<<field_to_string(values->value(data), values->get_width());
+            }
         }
         else {
-            // ASSUMES: string.
-            size += atoi(data.first.c_str() + 1);
+            out<<field_to_string(data, get_column_size(i));
         }
+        data += get_column_size(i);
+        offset += get_column_size(i);
+        out<<((i==metadata.size()-1)?(""):(","));
     }
 }
 
@@ -107,7 +215,7 @@ std::unordered_map<std::string, int> Schema::get_column_offset() const{
 std::vector<std::pair<int, int> > Schema::get_index_map() const{
     return index_map;
 }
-std::unordered_map<std::size_t*,int> Schema::get_index_hash() const{
+const HashIndex& Schema::get_index_hash() const{
     return index_hash;
 }
 
@@ -115,252 +223,625 @@ std::string Schema::get_filename() const {
     return schema_filename;
 }
 
+void Schema::set_scan_threads(unsigned threads) {
+    scan_threads = threads;
+}
+
 std::vector<std::string> Schema::get_table(const std::string& rel_filename,const std::string& field_name) const{
-    int offset=column_offset.at(field_name);    
-    int index=column_index.at(field_name);    
-
-    FILE* rel = fopen(rel_filename.c_str(), "rb");
-    fseek(rel,0,SEEK_END);
-    int rel_size = ftell(rel);        
-    int pos=0; 
-    fseek(rel,0,SEEK_SET); 
-    std::vector<std::string> data;                
-    while(pos<rel_size) {        
-        pos+=get_header_size();
-        fseek(rel,pos+offset,SEEK_SET);
-        int column_size=atoi(metadata[index].first.c_str()+1);            
-        char* value=(char*)malloc(sizeof(char)*column_size);               
-        fread(value,sizeof(char),column_size,rel); 
-        //std::cout<<rel_filename<<" "<<value<<std::endl;       
-        data.push_back(value);
-        pos+=get_data_size();
-    }
-    fclose(rel);
+    MappedRelation rel(rel_filename, get_row_size());
+    JoinColumn column=get_join_column(rel, field_name);
+    std::vector<std::string> data;
+    data.reserve(rel.get_row_count());
+    scan_morsels<std::vector<std::string>>(rel.get_row_count(), scan_threads,
+        [&](std::size_t begin, std::size_t end, std::vector<std::string>& values) {
+            values.reserve(end - begin);
+            for(std::size_t i = begin; i < end; i++) {
+                values.push_back(field_to_string(join_value(column, i), column.size));
+            }
+        },
+        [&](std::vector<std::string>& values) {
+            std::move(values.begin(), values.end(), std::back_inserter(data));
+        });
     return data;
 }
 
 std::unordered_map<std::string,std::vector<int>> Schema::get_table_map(const std::string& rel_filename,const std::string& field_name) const{
-    int offset=column_offset.at(field_name);    
-    int index=column_index.at(field_name);    
-
-    FILE* rel = fopen(rel_filename.c_str(), "rb");
-    fseek(rel,0,SEEK_END);
-    int rel_size = ftell(rel);        
-    int pos=0; 
-    fseek(rel,0,SEEK_SET); 
-    std::unordered_map<std::string,std::vector<int>> data;    
-    unsigned i=0;
-    while(pos<rel_size) { 
-        pos+=get_header_size();               
-        fseek(rel,pos+offset,SEEK_SET);
-        int column_size=atoi(metadata[index].first.c_str()+1);            
-        char* value=(char*)malloc(sizeof(char)*column_size);               
-        fread(value,sizeof(char),column_size,rel); 
-        //std::cout<<rel_filename<<" "<<value<<std::endl; 
-        if(data.find(value)!=data.end()){
-            data[value].push_back(i);
-        }   
-        else{
-            std::vector<int> indexes(1,i);
-            data.insert(std::make_pair(value,indexes));            
-        }               
-        i++;
-        pos+=get_data_size();
-    }    
-    fclose(rel);
+    MappedRelation rel(rel_filename, get_row_size());
+    JoinColumn column=get_join_column(rel, field_name);
+    std::unordered_map<std::string,std::vector<int>> data;
+    // Values are copied out in parallel, the map is filled in row order.
+    int row = 0;
+    scan_morsels<std::vector<std::string>>(rel.get_row_count(), scan_threads,
+        [&](std::size_t begin, std::size_t end, std::vector<std::string>& values) {
+            values.reserve(end - begin);
+            for(std::size_t i = begin; i < end; i++) {
+                values.push_back(field_to_string(join_value(column, i), column.size));
+            }
+        },
+        [&](std::vector<std::string>& values) {
+            for(std::size_t i = 0; i < values.size(); i++) {
+                data[values[i]].push_back(row++);
+            }
+        });
     return data;
 }
 
-void Schema::convert_to_bin(const std::string& csv_filename, const std::string& bin_filename, bool ignore_first_line) const {
-    std::ifstream csv_file(csv_filename);
-    FILE* bin_file = fopen(bin_filename.c_str(), "wb");
+JoinColumn Schema::get_join_column(const MappedRelation& rel, const std::string& field_name) const {
+    int index=column_index.at(field_name);
+    int offset=get_header_size()+column_offset.at(field_name);
+    const DictionaryColumn* dictionary=is_encoded(index) ? get_dictionary(rel, index) : NULL;
+    JoinColumn column = {rel, offset, dictionary ? dictionary->get_width() : get_column_size(index), dictionary};
+    return column;
+}
 
-    if(ignore_first_line) {
-        std::string line;
-        std::getline(csv_file, line);
+JoinKey Schema::get_join_key(const MappedRelation& rel, const std::vector<std::string>& field_names) const {
+    JoinKey key;
+    key.size = 0;
+    for(std::size_t c = 0; c < field_names.size(); c++) {
+        key.columns.push_back(get_join_column(rel, field_names[c]));
+        key.int_columns.push_back(is_int(column_index.at(field_names[c])));
+    }
+    return key;
+}
+
+namespace {
+
+// CSV lines handed to one converter thread.
+struct CsvChunk {
+    const char* begin;
+    const char* end;
+    int rows;
+    std::vector<std::unordered_set<std::string>> values; // distinct values of each encoded column
+};
+
+const std::size_t MIN_CHUNK_SIZE = 1 << 20;
+const std::size_t WRITE_BATCH_SIZE = 4 << 20;
+
+// Next line in [begin, end), without the newline (and carriage return).
+const char* next_line(const char* begin, const char* end, const char** line_end) {
+    const char* newline = static_cast<const char*>(memchr(begin, '\n', end - begin));
+    const char* stop = newline ? newline : end;
+    *line_end = (stop > begin && stop[-1] == '\r') ? stop - 1 : stop;
+    return newline ? newline + 1 : end;
+}
+
+// Saves the dictionary of the finished bin_filename, for its fingerprint;
+// false after saying why.
+bool save_dictionary(const Dictionary& dictionary, const std::string& bin_filename, int row_size) {
+    std::string filename = dictionary_filename(bin_filename);
+    unlink(filename.c_str());
+    if(dictionary.empty()) {
+        return true;
+    }
+    MappedRelation rel(bin_filename, row_size);
+    if(dictionary.save(filename, rel.get_fingerprint())) {
+        return true;
+    }
+    std::cout<<"Could not write "<<filename<<"."<<std::endl;
+    unlink(filename.c_str());
+    return false;
+}
+
+// Writes size bytes at offset, retrying short writes; false on an error.
+bool write_at(int fd, const char* buffer, std::size_t size, off_t offset) {
+    while(size > 0) {
+        ssize_t written = pwrite(fd, buffer, size, offset);
+        if(written < 0 && errno == EINTR) {
+            continue;
+        }
+        if(written <= 0) {
+            return false;
+        }
+        buffer += written;
+        size -= written;
+        offset += written;
+    }
+    return true;
+}
+
+// End of the field starting at line, the last column takes the rest of the line.
+const char* field_end(const char* line, const char* line_end, bool last) {
+    if(last) {
+        return line_end;
+    }
+    const char* comma = static_cast<const char*>(memchr(line, ',', line_end - line));
+    return comma ? comma : line_end;
+}
+
+int parse_int(const char* begin, const char* end) {
+    while(begin < end && (*begin == ' ' || *begin == '\t')) {
+        begin++;
+    }
+    bool negative = begin < end && *begin == '-';
+    if(begin < end && (*begin == '-' || *begin == '+')) {
+        begin++;
     }
+    int value = 0;
+    for(; begin < end && *begin >= '0' && *begin <= '9'; begin++) {
+        value = value * 10 + (*begin - '0');
+    }
+    return negative ? -value : value;
+}
 
-    int next_key = 0;
+}
 
-    while(csv_file.good() && csv_file.peek() != EOF) {
-        std::string timestamp = get_current_timestamp();
+void Schema::encode_row(const char* line, const char* line_end, int key, const char* timestamp, const Dictionary& dictionary, char* out) const {
+    memset(out, 0, get_row_size());
+    const char* row = out;
 
-        // Write header.
-        fwrite(&next_key, sizeof(int), 1, bin_file);
-        fwrite(timestamp.c_str(), sizeof(char), TIMESTAMP_SIZE, bin_file);
-        fwrite(&id, sizeof(int), 1, bin_file);
-        ++next_key;
+    // Header.
+    memcpy(out, &key, sizeof(int));
+    memcpy(out + sizeof(int), timestamp, TIMESTAMP_SIZE);
+    memcpy(out + sizeof(int) + TIMESTAMP_SIZE, &id, sizeof(int));
+    out += get_header_size();
 
-        // Write data.
-        for(unsigned i = 0; i < metadata.size(); ++i) {
-            const auto& data = metadata[i];
-            const char delimiter = (i == (metadata.size() - 1)) ? '\n' : ',';
+    // Data.
+    for(unsigned i = 0; i < metadata.size(); ++i) {
+        const char* token_end = field_end(line, line_end, i == metadata.size() - 1);
+
+        if (metadata[i].first[0] == 'i') {
+            const int int_token = parse_int(line, token_end);
+            memcpy(out, &int_token, sizeof(int));
+        }
+        else if (is_encoded(i)) {
+            const DictionaryColumn* values = dictionary.find(out - row);
+            std::size_t length = std::min<std::size_t>(token_end - line, get_value_size(i));
+            if(values) {
+                values->find_code(line, strnlen(line, length), out);
+            }
+        }
+        else {
+            // ASSUMES: string. Values longer than the column are cut.
+            memcpy(out, line, std::min<std::size_t>(token_end - line, get_column_size(i)));
+        }
+        out += get_column_size(i);
+        line = (token_end < line_end) ? token_end + 1 : line_end;
+    }
+}
 
-            std::string token;
-            std::getline(csv_file, token, delimiter);
+void Schema::convert_to_bin(const std::string& csv_filename, const std::string& bin_filename, bool ignore_first_line, unsigned threads, storage_layout layout) const {
+    // Field indexes of the old contents would point at the wrong rows.
+    remove_field_indexes(bin_filename);
 
-            if (data.first[0] == 'i') {
-                const int int_token = std::stoi(token);
-                fwrite(&int_token, sizeof(int), 1, bin_file);
-                //std::cout<<int_token<<std::endl;
+    if(layout == ROW_MAJOR) {
+        if(!write_rows(csv_filename, bin_filename, ignore_first_line, threads)) {
+            return;
+        }
+    }
+    else {
+        // Convert row-major first, then regroup each page by column or
+        // compress it block by block.
+        std::string rows_filename = bin_filename + ".rows.tmp";
+        if(!write_rows(csv_filename, rows_filename, ignore_first_line, threads)) {
+            return;
+        }
+        bool written;
+        Dictionary dictionary;
+        {
+            MappedRelation rows(rows_filename, get_row_size());
+            dictionary = rows.get_dictionary();
+            if(layout == PAX) {
+                written = write_pax(rows, get_field_widths(), bin_filename);
             }
             else {
-                // ASSUMES: string.
-                fwrite(token.c_str(), sizeof(char), atoi(data.first.c_str() + 1), bin_file);
-                //std::cout<<token.c_str()<<std::endl;
+                written = write_compressed(rows, bin_filename);
+            }
+        }
+        unlink(rows_filename.c_str());
+        unlink(dictionary_filename(rows_filename).c_str());
+        if(!written) {
+            std::cout<<"Could not open "<<bin_filename<<"."<<std::endl;
+            unlink(dictionary_filename(bin_filename).c_str());
+            unlink(zone_map_filename(bin_filename).c_str());
+            return;
+        }
+        if(!save_dictionary(dictionary, bin_filename, get_row_size())) {
+            unlink(bin_filename.c_str());
+            unlink(zone_map_filename(bin_filename).c_str());
+            return;
+        }
+    }
+
+    // Built over the final file, whatever its layout, so that it carries
+    // the fingerprint of that file.
+    MappedRelation rel(bin_filename, get_row_size());
+    if(!ZoneMap::build(rel, get_zone_fields(), zone_map_filename(bin_filename), threads)) {
+        std::cout<<"Could not open "<<zone_map_filename(bin_filename)<<"."<<std::endl;
+    }
+}
+
+bool Schema::write_rows(const std::string& csv_filename, const std::string& bin_filename, bool ignore_first_line, unsigned threads) const {
+    MappedRelation csv_file(csv_filename, 1);
+    const char* begin = csv_file.get_data();
+    const char* end = begin + csv_file.get_size();
+
+    if(ignore_first_line) {
+        const char* line_end;
+        begin = next_line(begin, end, &line_end);
+    }
+
+    // Split into newline-aligned chunks, small files are not worth a thread.
+    if(threads == 0) {
+        threads = default_thread_count();
+    }
+    threads = std::max<std::size_t>(1, std::min<std::size_t>(threads, (end - begin) / MIN_CHUNK_SIZE));
+    std::vector<CsvChunk> chunks(threads);
+    const char* chunk_begin = begin;
+    for(unsigned t = 0; t < threads; t++) {
+        const char* chunk_end = (t == threads - 1) ? end : begin + (end - begin) * (t + 1) / threads;
+        if(chunk_end < chunk_begin) {
+            chunk_end = chunk_begin;
+        }
+        else if(chunk_end > chunk_begin && chunk_end < end && chunk_end[-1] != '\n') {
+            const char* line_end;
+            chunk_end = next_line(chunk_end, end, &line_end);
+        }
+        chunks[t].begin = chunk_begin;
+        chunks[t].end = chunk_end;
+        chunk_begin = chunk_end;
+    }
+
+    std::vector<unsigned> encoded;
+    for(unsigned i = 0; i < metadata.size(); i++) {
+        if(is_encoded(i)) {
+            encoded.push_back(i);
+        }
+    }
+
+    // Count rows per chunk, so every chunk knows its key range upfront, and
+    // gather the values of the encoded columns.
+    run_parallel(threads, [&](unsigned t) {
+        CsvChunk& chunk = chunks[t];
+        chunk.rows = 0;
+        chunk.values.resize(encoded.size());
+        for(const char* line = chunk.begin; line < chunk.end; ) {
+            const char* line_end;
+            const char* next = next_line(line, chunk.end, &line_end);
+            if(line_end > line) {
+                chunk.rows++;
+                const char* field = line;
+                for(unsigned i = 0, e = 0; e < encoded.size(); i++) {
+                    const char* token_end = field_end(field, line_end, i == metadata.size() - 1);
+                    if(i == encoded[e]) {
+                        std::size_t length = std::min<std::size_t>(token_end - field, get_value_size(i));
+                        chunk.values[e++].insert(std::string(field, strnlen(field, length)));
+                    }
+                    field = (token_end < line_end) ? token_end + 1 : line_end;
+                }
             }
+            line = next;
+        }
+    });
+    std::vector<int> first_key(threads, 0);
+    for(unsigned t = 1; t < threads; t++) {
+        first_key[t] = first_key[t - 1] + chunks[t - 1].rows;
+    }
+
+    // Codes follow the sorted values, whatever chunk saw a value first.
+    Dictionary dictionary;
+    for(unsigned e = 0; e < encoded.size(); e++) {
+        std::unordered_set<std::string> values;
+        for(unsigned t = 0; t < threads; t++) {
+            values.insert(chunks[t].values[e].begin(), chunks[t].values[e].end());
+            std::unordered_set<std::string>().swap(chunks[t].values[e]);
         }
+        dictionary.add_column(get_header_size() + column_offset.at(metadata[encoded[e]].second), get_value_size(encoded[e]),
+                              std::vector<std::string>(values.begin(), values.end()));
     }
 
-    fclose(bin_file);
-    csv_file.close();
+    int bin_file = open(bin_filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(bin_file < 0) {
+        std::cout<<"Could not open "<<bin_filename<<"."<<std::endl;
+        return false;
+    }
+
+    // Every row of one conversion gets the same timestamp.
+    std::string timestamp = get_current_timestamp();
+    timestamp.resize(TIMESTAMP_SIZE, '\0');
+
+    // Parse each chunk into a reusable buffer and write it at its final place.
+    const std::size_t row_size = get_row_size();
+    const std::size_t batch_rows = std::max<std::size_t>(1, WRITE_BATCH_SIZE / row_size);
+    std::atomic<bool> write_failed(false);
+    run_parallel(threads, [&](unsigned t) {
+        const CsvChunk& chunk = chunks[t];
+        std::vector<char> buffer(std::min<std::size_t>(batch_rows, chunk.rows) * row_size);
+        int key = first_key[t];
+        std::size_t buffered = 0;
+
+        for(const char* line = chunk.begin; line < chunk.end; ) {
+            const char* line_end;
+            const char* next = next_line(line, chunk.end, &line_end);
+            if(line_end > line) {
+                encode_row(line, line_end, key + buffered, timestamp.data(), dictionary, &buffer[buffered * row_size]);
+                if(++buffered == batch_rows) {
+                    if(write_failed || !write_at(bin_file, buffer.data(), buffered * row_size, static_cast<off_t>(key) * row_size)) {
+                        write_failed = true;
+                        return;
+                    }
+                    key += buffered;
+                    buffered = 0;
+                }
+            }
+            line = next;
+        }
+        if(buffered > 0 && !write_at(bin_file, buffer.data(), buffered * row_size, static_cast<off_t>(key) * row_size)) {
+            write_failed = true;
+        }
+    });
+
+    if(close(bin_file) != 0 || write_failed) {
+        // A truncated or holed file must not pass for the relation.
+        std::cout<<"Could not write "<<bin_filename<<"."<<std::endl;
+        unlink(bin_filename.c_str());
+        unlink(dictionary_filename(bin_filename).c_str());
+        unlink(zone_map_filename(bin_filename).c_str());
+        return false;
+    }
+    if(!save_dictionary(dictionary, bin_filename, get_row_size())) {
+        // The codes in the rows mean nothing without it.
+        unlink(bin_filename.c_str());
+        unlink(zone_map_filename(bin_filename).c_str());
+        return false;
+    }
+    return true;
 }
 
 void Schema::print_binary(const std::string& bin_filename) const{
-    FILE* bin_file = fopen(bin_filename.c_str(),"rb");
-    int offset=get_header_size();
-    fseek(bin_file,0,SEEK_SET);
-
-    while(!feof(bin_file)){
-        fseek(bin_file,offset,SEEK_CUR);
-        for(unsigned i = 0; i < metadata.size() ; i++){
-            if (metadata[i].first[0] == 'i') {
-                int int_token;
-                fread(&int_token, sizeof(int), 1, bin_file);
-                std::cout<<int_token;
+    MappedRelation rel(bin_filename, get_row_size());
+    check_dictionaries(rel);
+    scan_morsels<std::string>(rel.get_row_count(), scan_threads,
+        [&](std::size_t begin, std::size_t end, std::string& text) {
+            std::ostringstream out;
+            std::vector<char> buffer;
+            for(std::size_t i = begin; i < end;) {
+                const char* rows;
+                std::size_t count = std::min(rel.read_rows(i, buffer, &rows), end - i);
+                for(std::size_t r = 0; r < count; r++) {
+                    print_row(rows + r * get_row_size() + get_header_size(), rel.get_dictionary(), out);
+                    out<<'\n';
+                }
+                i += count;
             }
-            else{
-                size_t string_size=atoi(metadata[i].first.c_str()+1);
-                char* data_value=(char*)malloc(sizeof(char)*string_size);
-                fread(data_value,sizeof(char),string_size,bin_file);  
-                std::cout<<data_value;  
-            }  
-            if(i==metadata.size()-1){
-                std::cout<<std::endl;
-            }   
-            else{
-                std::cout<<",";
-            }                       
-        }        
-    }
-    
-    fclose(bin_file);
+            text = out.str();
+        },
+        [&](std::string& text) {
+            std::cout<<text;
+        });
+    std::cout<<std::flush;
 }
 
 void Schema::create_index(const std::string& bin_filename, const std::string& index_filename) const {
-    FILE* bin_file = fopen(bin_filename.c_str(), "rb");
+    MappedRelation rel(bin_filename, get_row_size());
     FILE* index_file = fopen(index_filename.c_str(), "wb");
 
-    int offset = 0;
-    int pace = HEADER_SIZE + size - sizeof(int);
-    int key;
-
-    while(fread(&key, sizeof(int), 1, bin_file)) {
-        fwrite(&key, sizeof(int), 1, index_file);
+    for(std::size_t i = 0; i < rel.get_row_count(); i++) {
+        int offset = rel.get_position(i);
+        fwrite(rel.get_field(i, 0), sizeof(int), 1, index_file);
         fwrite(&offset, sizeof(int), 1, index_file);
-
-        offset += pace;
-        fseek(bin_file, pace, SEEK_CUR);
     }
 
     fclose(index_file);
-    fclose(bin_file);
 }
 
-void Schema::create_index_bplus(const std::string& bin_filename, const std::string& index_filename) const {
-    FILE* bin_file = fopen(bin_filename.c_str(), "rb");
-    bpt::bplus_tree bplus(index_filename.c_str(), true);
+namespace {
 
-    int offset = 0;
-    int pace = HEADER_SIZE + size - sizeof(int);
-    int key;
+// Hands sorted (key, row position) records to the B+ tree bulk loader.
+class RecordSource : public bpt::record_source_t {
+public:
+    RecordSource(const std::vector<bpt::record_t>& records) : records(records), next_record(0) {}
 
-    while(fread(&key, sizeof(int), 1, bin_file)) {
-        bplus.insert(bpt::key_t(std::to_string(key).c_str()), offset);
-        offset += pace;
+    bool next(bpt::record_t* record) {
+        if(next_record == records.size()) {
+            return false;
+        }
+        *record = records[next_record++];
+        return true;
     }
 
-    fclose(bin_file);
-}
+private:
+    const std::vector<bpt::record_t>& records;
+    std::size_t next_record;
+};
 
-void Schema:: create_index_direct_hash(const std::string& csv_filename, const std::string& bin_filename, bool ignore_first_line) const {
-    std::ifstream csv_file(csv_filename);
-    FILE* bin_file = fopen(bin_filename.c_str(), "wb");
-
-    if(ignore_first_line) {
-        std::string line;
-        std::getline(csv_file, line);
-    }
+bool record_less(const bpt::record_t& op1, const bpt::record_t& op2) {
+    return bpt::keycmp(op1.key, op2.key) < 0;
+}
 
-    int next_key = 0;
+}
 
-    std::size_t int_hash;
-    std::hash<int> hash_fn;
+void Schema::create_index_bplus(const std::string& bin_filename, const std::string& index_filename, double fill_factor) const {
+    MappedRelation rel(bin_filename, get_row_size());
+    std::vector<bpt::record_t> records(rel.get_row_count());
 
+    for(std::size_t i = 0; i < rel.get_row_count(); i++) {
+        int key;
+        memcpy(&key, rel.get_field(i, 0), sizeof(int));
+        records[i].key = bpt::key_t(key);
+        records[i].value = rel.get_position(i);
+    }
 
-    while(csv_file.good() && csv_file.peek() != EOF) {
-        std::string timestamp = get_current_timestamp();
+    // keys from convert_to_bin are already in order, only sort other files
+    if(!std::is_sorted(records.begin(), records.end(), record_less)) {
+        std::sort(records.begin(), records.end(), record_less);
+    }
 
-        // Compute hash value.
-        int_hash = hash_fn(next_key);
-        fseek(bin_file, int_hash, SEEK_SET);
-    
-        // Write header.
-        fwrite(&next_key, sizeof(int), 1, bin_file);
-        fwrite(timestamp.c_str(), sizeof(char), TIMESTAMP_SIZE, bin_file);
-        fwrite(&id, sizeof(int), 1, bin_file);
-    
-        ++next_key;
+    bpt::bplus_tree bplus(index_filename.c_str(), true);
+    RecordSource source(records);
+    if(bplus.bulk_load(source, records.size(), fill_factor) != 0) {
+        std::cout<<"Duplicate keys in "<<bin_filename<<", index left empty."<<std::endl;
+    }
+}
 
-        // Write data.
-        for(unsigned i = 0; i < metadata.size(); ++i) {
-            const auto& data = metadata[i];
-            const char delimiter = (i == (metadata.size() - 1)) ? '\n' : ',';
+namespace {
+
+// Static hash file: a header page, then one page per bucket, then the
+// overflow pages. A bucket page holds a BucketHeader and up to
+// rows_per_bucket rows, full buckets chain to overflow pages.
+struct HashFileHeader {
+    int magic;
+    int bucket_count;
+    int rows_per_bucket;
+    int row_size;
+    int page_size;
+};
+
+struct BucketHeader {
+    int count;
+    int overflow; // page number of the next page of the bucket, 0 if none
+};
+
+const int HASH_FILE_MAGIC = 0x48534831;
+const int HASH_FILE_PAGE_SIZE = 4096;
+
+// Scales the hash into [0, bucket_count) using its well mixed top bits.
+int bucket_of(int key, int bucket_count) {
+    return (static_cast<uint64_t>(hash_int(key)) * bucket_count) >> 32;
+}
 
-            std::string token;
-            std::getline(csv_file, token, delimiter);
+}
 
-            if (data.first[0] == 'i') {
-                const int int_token = std::stoi(token);
-                fwrite(&int_token, sizeof(int), 1, bin_file);
-            }
-            else {
-                // ASSUMES: string.
-                fwrite(token.c_str(), sizeof(char), atoi(data.first.c_str() + 1), bin_file);
-            }
+void Schema::create_index_direct_hash(const std::string& csv_filename, const std::string& bin_filename, bool ignore_first_line) const {
+    // Hash files keep no side files, so there is nowhere to put dictionaries.
+    for(unsigned i = 0; i < metadata.size(); i++) {
+        if(is_encoded(i)) {
+            std::cout<<"Dictionary-encoded columns are not supported by direct hash files."<<std::endl;
+            return;
         }
     }
+    MappedRelation csv_file(csv_filename, 1);
+    const char* begin = csv_file.get_data();
+    const char* end = begin + csv_file.get_size();
 
-    fclose(bin_file);
-    csv_file.close();
-}
+    if(ignore_first_line) {
+        const char* line_end;
+        begin = next_line(begin, end, &line_end);
+    }
 
-void Schema::create_index_indirect_hash(const std::string& bin_filename, const std::string& index_filename) const {
+    // Keys follow the line order, like in convert_to_bin.
+    std::vector<std::pair<const char*, const char*>> lines;
+    for(const char* line = begin; line < end; ) {
+        const char* line_end;
+        const char* next = next_line(line, end, &line_end);
+        if(line_end > line) {
+            lines.push_back(std::make_pair(line, line_end));
+        }
+        line = next;
+    }
+    const int rows = lines.size();
+
+    HashFileHeader header;
+    header.magic = HASH_FILE_MAGIC;
+    header.row_size = get_row_size();
+    header.page_size = HASH_FILE_PAGE_SIZE;
+    while(header.page_size < static_cast<int>(sizeof(BucketHeader)) + header.row_size) {
+        header.page_size += HASH_FILE_PAGE_SIZE;
+    }
+    header.rows_per_bucket = (header.page_size - sizeof(BucketHeader)) / header.row_size;
 
-    FILE* bin_file = fopen(bin_filename.c_str(), "rb");
-    FILE* index_file = fopen(index_filename.c_str(), "wb");
+    // Aim for buckets three quarters full, so most lookups read one page.
+    int target_rows = std::max(1, header.rows_per_bucket * 3 / 4);
+    header.bucket_count = std::max(1, (rows + target_rows - 1) / target_rows);
 
-    int offset = 0;
-    int pace = HEADER_SIZE + size - sizeof(int);
-    int key;
+    // Group the keys by bucket.
+    std::vector<int> bucket_start(header.bucket_count + 1, 0);
+    for(int key = 0; key < rows; key++) {
+        bucket_start[bucket_of(key, header.bucket_count) + 1]++;
+    }
+    for(int b = 0; b < header.bucket_count; b++) {
+        bucket_start[b + 1] += bucket_start[b];
+    }
+    std::vector<int> keys(rows);
+    std::vector<int> cursor(bucket_start.begin(), bucket_start.end() - 1);
+    for(int key = 0; key < rows; key++) {
+        keys[cursor[bucket_of(key, header.bucket_count)]++] = key;
+    }
 
-    std::size_t int_hash;
-    std::hash<int> hash_fn;
+    FILE* bin_file = fopen(bin_filename.c_str(), "wb");
+    if(!bin_file) {
+        std::cout<<"Could not open "<<bin_filename<<"."<<std::endl;
+        return;
+    }
+    std::vector<char> page(header.page_size, 0);
+    memcpy(page.data(), &header, sizeof(header));
+    bool written = fwrite(page.data(), header.page_size, 1, bin_file) == 1;
+
+    std::string timestamp = get_current_timestamp();
+    timestamp.resize(TIMESTAMP_SIZE, '\0');
+
+    const Dictionary no_dictionary;
+
+    // Write the `chain`-th page of bucket b, linking it to page `overflow`.
+    auto write_page = [&](int b, int chain, int overflow) {
+        int first = bucket_start[b] + chain * header.rows_per_bucket;
+        BucketHeader bucket;
+        bucket.count = std::min(header.rows_per_bucket, bucket_start[b + 1] - first);
+        bucket.overflow = overflow;
+
+        std::fill(page.begin(), page.end(), 0);
+        memcpy(page.data(), &bucket, sizeof(bucket));
+        for(int i = 0; i < bucket.count; i++) {
+            int key = keys[first + i];
+            encode_row(lines[key].first, lines[key].second, key, timestamp.data(), no_dictionary, &page[sizeof(bucket) + i * header.row_size]);
+        }
+        written = fwrite(page.data(), header.page_size, 1, bin_file) == 1 && written;
+    };
+    auto chain_length = [&](int b) {
+        int count = bucket_start[b + 1] - bucket_start[b];
+        return std::max(1, (count + header.rows_per_bucket - 1) / header.rows_per_bucket);
+    };
+
+    // Primary pages first, overflow pages are numbered in bucket order after them.
+    int next_overflow = 1 + header.bucket_count;
+    for(int b = 0; b < header.bucket_count; b++) {
+        int chain = chain_length(b);
+        write_page(b, 0, chain > 1 ? next_overflow : 0);
+        next_overflow += chain - 1;
+    }
+    next_overflow = 1 + header.bucket_count;
+    for(int b = 0; b < header.bucket_count; b++) {
+        int chain = chain_length(b);
+        for(int c = 1; c < chain; c++) {
+            next_overflow++;
+            write_page(b, c, c + 1 < chain ? next_overflow : 0);
+        }
+    }
 
-    while(fread(&key, sizeof(int), 1, bin_file)) {
+    if(fclose(bin_file) != 0 || !written) {
+        std::cout<<"Could not write "<<bin_filename<<"."<<std::endl;
+        unlink(bin_filename.c_str());
+    }
+}
 
-        // compute hash value
-        int_hash = hash_fn(key);
-    
-        fwrite(&int_hash, sizeof(size_t), 1, index_file);
-        fwrite(&offset, sizeof(int), 1, index_file);
+void Schema::create_index_indirect_hash(const std::string& bin_filename, const std::string& index_filename) const {
+    MappedRelation rel(bin_filename, get_row_size());
+    HashIndex index;
+    index.reserve(rel.get_row_count());
+
+    for(std::size_t i = 0; i < rel.get_row_count(); i++) {
+        int key;
+        memcpy(&key, rel.get_field(i, 0), sizeof(int));
+        index.insert(key, rel.get_position(i));
+    }
 
-        offset += pace;
-        fseek(bin_file, pace, SEEK_CUR);
+    if(!index.save(index_filename)) {
+        std::cout<<"Could not write "<<index_filename<<"."<<std::endl;
     }
+}
 
-    fclose(index_file);
-    fclose(bin_file);
+void Schema::create_field_index(const std::string& bin_filename, const std::string& field_name, std::size_t memory_budget) const {
+    if(column_offset.find(field_name)==column_offset.end()){
+        std::cout<<"Column not in table schema."<<std::endl;
+        return;
+    }
+    MappedRelation rel(bin_filename, get_row_size());
+    JoinColumn column=get_join_column(rel, field_name);
+    std::string index_filename=field_index_filename(bin_filename, field_name);
+    if(!FieldIndex::build(column, index_filename, memory_budget)){
+        std::cout<<"Could not write "<<index_filename<<"."<<std::endl;
+        return;
+    }
+    std::cout<<"Index written to "<<index_filename<<std::endl;
 }
 
 void Schema::load_index(const std::string& index_filename) {
@@ -382,80 +863,97 @@ void Schema::load_index_bplus(const std::string& index_filename) {
 }
 
 void Schema::load_index_indirect_hash(const std::string& index_filename) {
-    
-    index_hash.clear();
-
-    FILE* index_file = fopen(index_filename.c_str(), "rb");
-    int key, offset;
-    
-    std::size_t int_hash;
-    std::hash<int> hash_fn; 
-
-    while(fread(&key, sizeof(int), 1, index_file)) {
-        fread(&offset, sizeof(int), 1, index_file);
-        
-        int_hash = hash_fn(key);
-        index_hash.insert(std::make_pair(&int_hash, offset));
-    }
-
-    fclose(index_file);
+    index_hash.load(index_filename);
 }
 
 
-void Schema::load_data(int pos, const std::string& bin_filename){
-    if(pos!=-1){
-        FILE* bin_file = fopen(bin_filename.c_str(),"rb");
-        pos += get_header_size();
-        fseek(bin_file,pos,SEEK_SET);    
-        int string_size;
+void Schema::load_data(int pos, const std::string& bin_filename) const{
+    MappedRelation rel(bin_filename, get_row_size());
+    load_data(pos, rel);
+}
 
-        for(unsigned i = 0; i < metadata.size() ; i++){
-            string_size=atoi(metadata[i].first.c_str()+1);
-            char* data_value=(char*)malloc(sizeof(char)*string_size);        
-            fread(data_value,sizeof(char),string_size,bin_file);
-            std::cout<<data_value<<((i==metadata.size()-1)?(""):(","));//<<column_offset[metadata[i].second]<<std::endl;
-            pos+=string_size;
-        }
-        fclose(bin_file);
+void Schema::load_data(int pos, const MappedRelation& rel, std::ostream& out) const{
+    check_dictionaries(rel);
+    std::vector<char> buffer(get_row_size());
+    const char* row=rel.read_row_at(pos, buffer.data());
+    if(row){
+        print_row(row+get_header_size(), rel.get_dictionary(), out);
     }
     else{ // print null columns for pos=-1 (used in joins)
         for(unsigned i = 0; i < metadata.size() ; i++){            
-            std::cout<<"NULL"<<((i==metadata.size()-1)?(""):(","));//<<column_offset[metadata[i].second]<<std::endl;            
+            out<<"NULL"<<((i==metadata.size()-1)?(""):(","));
         }
     }
 }
 
 std::vector<int> Schema::search_field(std::string field_name, std::string field_value, const std::string& bin_filename, int init_pos = 0) const{
+    MappedRelation rel(bin_filename, get_row_size());
+    return search_field(field_name, field_value, rel, init_pos);
+}
+
+std::vector<int> Schema::search_field(std::string field_name, std::string field_value, const MappedRelation& rel, int init_pos = 0) const{
+    const std::string& bin_filename=rel.get_filename();
     std::vector<int> pos_vec;
     if(column_offset.find(field_name)!=column_offset.end()){
-        int offset=column_offset.at(field_name);
-        int index=column_index.at(field_name);
-        FILE* binfile = fopen(bin_filename.c_str(), "rb");    
-        int string_size;
-        int pos = init_pos;
-        int row_pos;
-        int file_size;        
-
-        fseek(binfile,0,SEEK_END);
-        file_size = ftell(binfile);
-
-        while(file_size > pos) {
-            row_pos = pos;
-
-            //Jump the header
-            pos += get_header_size();
-            fseek(binfile,pos+offset,SEEK_SET);                    
-            string_size=atoi(metadata[index].first.c_str()+1);            
-            char* data_value=(char*)malloc(sizeof(char)*string_size);                
-            fread(data_value,sizeof(char),string_size,binfile);
-            if (data_value == field_value){
-                //std::cout<<data[0]<<row_pos<<std::endl;
-                pos_vec.push_back(row_pos);
-            }                        
-            pos+=get_data_size();
+        JoinColumn column=get_join_column(rel, field_name);
+
+        FieldIndex index;
+        if(index.open(field_index_filename(bin_filename, field_name), rel)){
+            index.lookup(field_value.c_str(), field_value.size()+1, column, pos_vec);
+            std::sort(pos_vec.begin(), pos_vec.end());
+            pos_vec.erase(pos_vec.begin(), std::lower_bound(pos_vec.begin(), pos_vec.end(), init_pos));
+            return pos_vec;
         }
 
-        fclose(binfile);
+        // An encoded column is scanned for the code of the value.
+        std::string needle=field_value;
+        int string_size=get_column_size(column_index.at(field_name));
+        if(is_encoded(column_index.at(field_name))){
+            char code[CODE_SIZE];
+            if(!column.dictionary || !column.dictionary->find_code(field_value.c_str(), field_value.size(), code)){
+                return pos_vec;
+            }
+            needle.assign(code, CODE_SIZE);
+        }
+
+        // Zones that cannot hold the needle are skipped, without a zone map
+        // the file is one zone.
+        std::size_t zone_rows = std::max<std::size_t>(1, rel.get_row_count());
+        std::vector<bool> candidate(1, true);
+        ZoneMap zones;
+        if(zones.open(zone_map_filename(bin_filename), rel)){
+            zone_rows = zones.get_zone_rows();
+            candidate.resize(zones.get_zone_count());
+            for(std::size_t z = 0; z < zones.get_zone_count(); z++){
+                candidate[z] = zones.may_equal(z, column.offset, needle.data(), needle.size());
+            }
+        }
+
+        std::size_t first_row = init_pos / get_row_size();
+        std::size_t rows = rel.get_row_count() > first_row ? rel.get_row_count() - first_row : 0;
+        scan_morsels<std::vector<int>>(rows, scan_threads,
+            [&](std::size_t begin, std::size_t end, std::vector<int>& matches) {
+                // A PAX file is contiguous per column only inside a page, a
+                // compressed one is read a block at a time.
+                std::vector<char> buffer;
+                for(std::size_t row = first_row + begin; row < first_row + end;) {
+                    std::size_t zone_end = std::min((row / zone_rows + 1) * zone_rows, first_row + end);
+                    if(!candidate[row / zone_rows]) {
+                        row = zone_end;
+                        continue;
+                    }
+                    const char* fields;
+                    std::size_t stride;
+                    std::size_t count = std::min(rel.get_field_run(row, column.offset, &fields, &stride, buffer), zone_end - row);
+                    scan_field_equal(fields, count, stride, string_size, needle, row, matches);
+                    row += count;
+                }
+            },
+            [&](std::vector<int>& matches) {
+                for(std::size_t i = 0; i < matches.size(); i++) {
+                    pos_vec.push_back(rel.get_position(matches[i]));
+                }
+            });
     }
     else{
         std::cout<<"Column not in table schema."<<std::endl;
@@ -473,400 +971,462 @@ int Schema::search_for_key(int key) const {
 int Schema::search_for_key_bplus(int key) const {
     bpt::value_t value;
     // NOTE: if the return value is (-1), then such key hasn't been found.
-    bplus->search(bpt::key_t(std::to_string(key).c_str()), &value);
+    if(bplus->search(bpt::key_t(key), &value) != 0) {
+        return -1;
+    }
     return value;
 }
 
 int Schema::search_for_key_indirect_hash(int key) const {
-
-    // apply hash
-    std::size_t int_hash; 
-    std::hash<int> hash_fn; 
-    int_hash = hash_fn(key);
-
-    // find value in table
-    std::unordered_map<std::size_t*,int>::const_iterator got = index_hash.find (&int_hash);
-    return got->second; 
+    // NOTE: if the return value is (-1), then such key hasn't been found.
+    return index_hash.find(key);
 }
 
 int Schema::search_for_key_direct_hash(int key, const std::string& bin_filename) const {
-
     FILE* binfile = fopen(bin_filename.c_str(), "rb");
+    if(!binfile) {
+        return -1;
+    }
+
+    HashFileHeader header;
+    if(!fread(&header, sizeof(header), 1, binfile) || header.magic != HASH_FILE_MAGIC) {
+        fclose(binfile);
+        return -1;
+    }
 
-    int k;
+    // One read per page of the bucket, usually just the first one.
+    std::vector<char> page(header.page_size);
+    int page_number = 1 + bucket_of(key, header.bucket_count);
+    while(page_number != 0) {
+        long page_pos = static_cast<long>(page_number) * header.page_size;
+        fseek(binfile, page_pos, SEEK_SET);
+        if(!fread(page.data(), header.page_size, 1, binfile)) {
+            break;
+        }
 
-    //find record
-    std::size_t int_hash=0;
-    std::hash<int> hash_fn;
-    fseek(binfile, hash_fn(key), SEEK_CUR); 
-    
-    if(fread(&k, sizeof(int), 1, binfile)){
-        if (k == key) {
-         fclose(binfile);
-         return int_hash;
+        BucketHeader bucket;
+        memcpy(&bucket, page.data(), sizeof(bucket));
+        for(int i = 0; i < bucket.count; i++) {
+            int row = sizeof(bucket) + i * header.row_size;
+            int k;
+            memcpy(&k, &page[row], sizeof(int));
+            if (k == key) {
+                fclose(binfile);
+                return page_pos + row;
+            }
         }
+        page_number = bucket.overflow;
     }
-          
+
     fclose(binfile);
     return -1;
 }
 
 int Schema::search_for_key_raw(int key, const std::string& bin_filename) const {
+    MappedRelation rel(bin_filename, get_row_size());
+
+    // Only zones whose key range holds the key are read.
+    ZoneMap zones;
+    bool pruned = zones.open(zone_map_filename(bin_filename), rel);
+    std::size_t zone_rows = pruned ? zones.get_zone_rows() : std::max<std::size_t>(1, rel.get_row_count());
+    for(std::size_t first = 0; first < rel.get_row_count(); first += zone_rows) {
+        if(pruned && !zones.may_equal(first / zone_rows, 0, key)) {
+            continue;
+        }
+        for(std::size_t i = first; i < std::min(rel.get_row_count(), first + zone_rows); i++) {
+            int k;
+            memcpy(&k, rel.get_field(i, 0), sizeof(int));
+            if (k == key) {
+                return rel.get_position(i);
+            }
+        }
+    }
+    return -1;
+}
+namespace {
+
+// Prints each joined row as it arrives, reading both sides from the mapped
+// relations.
+class JoinPrinter : public JoinSink {
+public:
+    JoinPrinter(const Schema& schema1, const MappedRelation& rel1, const Schema& schema2, const MappedRelation& rel2, std::ostream& out) :
+        schema1(schema1), rel1(rel1), schema2(schema2), rel2(rel2), out(out) {}
+    void consume(int pos1, int pos2) {
+        schema1.load_data(pos1, rel1, out);
+        out<<",";
+        schema2.load_data(pos2, rel2, out);
+        out<<"\n";
+    }
 
-    FILE* binfile = fopen(bin_filename.c_str(), "rb");
+private:
+    const Schema& schema1;
+    const MappedRelation& rel1;
+    const Schema& schema2;
+    const MappedRelation& rel2;
+    std::ostream& out;
+};
+
+// Prints the rel1 row of each pair, for semi and anti joins.
+class RowPrinter : public JoinSink {
+public:
+    RowPrinter(const Schema& schema, const MappedRelation& rel, std::ostream& out) :
+        schema(schema), rel(rel), out(out) {}
+    void consume(int pos1, int) {
+        schema.load_data(pos1, rel, out);
+        out<<"\n";
+    }
 
-    int offset = 0;
-    int pace = HEADER_SIZE + size - sizeof(int);
-    int k;
+private:
+    const Schema& schema;
+    const MappedRelation& rel;
+    std::ostream& out;
+};
 
-    while(fread(&k, sizeof(int), 1, binfile)) {
+}
 
-        if (k == key) {
-            fclose(binfile);
-            return offset;
-        }
-        offset += pace;
-        fseek(binfile, pace, SEEK_CUR);
+void Schema::join(Schema &schema2,Join_Conditions jc){
+    // Semi and anti joins only print the columns of rel1.
+    bool rel1_only=jc.type==SEMI || jc.type==ANTI;
+    for(unsigned i=0;i<metadata.size();i++){
+        std::cout<<metadata[i].second<<((rel1_only && i==metadata.size()-1)?(""):(","));
+    }
+    std::vector<std::pair<std::string, std::string>> metadata2=schema2.get_metadata();
+    for(unsigned j=0;!rel1_only && j<metadata2.size();j++){
+        std::cout<<metadata2[j].second<<((j==metadata2.size()-1)?(""):(","));   
     }
+    std::cout<<std::endl;   
 
-    fclose(binfile);
-    return -1;
-}
-void Schema::join(Schema &schema2,Join_Conditions jc){
-    std::vector<std::pair<int,int>> pos_vector;
+    MappedRelation rel1(jc.rel1_filename, get_row_size());
+    MappedRelation rel2(jc.rel2_filename, schema2.get_row_size());
+    JoinPrinter printer(*this, rel1, schema2, rel2, std::cout);
+    RowPrinter row_printer(*this, rel1, std::cout);
     switch(jc.type){
         case NATURAL_INNER:{
-            pos_vector=join_natural_inner(schema2,jc);
+            join_natural_inner(schema2,jc,printer);
             break;
         }
         case NATURAL_LEFT:{
-            pos_vector=join_natural_left(schema2,jc);
+            join_natural_left(schema2,jc,printer);
             break;
         }
         case NATURAL_RIGHT:{
-            pos_vector=join_natural_right(schema2,jc);
+            join_natural_right(schema2,jc,printer);
             break;
         }
         case NATURAL_FULL:{
-            pos_vector=join_natural_full(schema2,jc);
+            join_natural_full(schema2,jc,printer);
+            break;
+        }
+        case SEMI:{
+            join_semi(schema2,jc,row_printer);
+            break;
+        }
+        case ANTI:{
+            join_anti(schema2,jc,row_printer);
         }
     }   
-    for(unsigned i=0;i<metadata.size();i++){
-        std::cout<<metadata[i].second<<",";
-    }
-    std::vector<std::pair<std::string, std::string>> metadata2=schema2.get_metadata();
-    for(unsigned j=0;j<metadata2.size();j++){
-        std::cout<<metadata2[j].second<<((j==metadata2.size()-1)?(""):(","));   
-    }
-    std::cout<<std::endl;   
-    for(unsigned i=0;i<pos_vector.size();i++){
-        load_data(pos_vector[i].first,jc.rel1_filename);
-        std::cout<<",";
-        schema2.load_data(pos_vector[i].second,jc.rel2_filename);
-        std::cout<<std::endl;
-    }    
+    std::cout<<std::flush;
 }
 
 std::vector<std::pair<int,int>> Schema::join_natural_inner(Schema &schema2,Join_Conditions jc){
-    std::vector<std::pair<int,int>> pos_vector_left,pos_vector_right,pos_vector;    
-    pos_vector_left=join_natural_left(schema2,jc);
-    pos_vector_right=join_natural_right(schema2,jc);
-    for(unsigned i=0;i<pos_vector_left.size();i++){        
-        for(unsigned j=0;j<pos_vector_right.size();j++){
-            if(pos_vector_left[i]==pos_vector_right[j]){
-                pos_vector.push_back(pos_vector_right[j]);
-            }
-        }        
-    }
+    std::vector<std::pair<int,int>> pos_vector;
+    JoinCollector collector(pos_vector);
+    join_natural_inner(schema2,jc,collector);
     return pos_vector;
 }
 
+void Schema::join_natural_inner(Schema &schema2,Join_Conditions jc,JoinSink& sink){
+    InnerJoinSink inner(sink);
+    join_natural_left(schema2,jc,inner);
+}
+
 std::vector<std::pair<int,int>> Schema::join_natural_left(Schema &schema2,Join_Conditions jc){
     std::vector<std::pair<int,int>> pos_vector;
+    JoinCollector collector(pos_vector);
+    join_natural_left(schema2,jc,collector);
+    return pos_vector;
+}
+
+namespace {
+
+std::vector<std::string> split_field_names(const std::string& field_name) {
+    std::vector<std::string> field_names;
+    std::size_t begin = 0;
+    for(std::size_t end; (end = field_name.find(',', begin)) != std::string::npos; begin = end + 1) {
+        field_names.push_back(field_name.substr(begin, end - begin));
+    }
+    field_names.push_back(field_name.substr(begin));
+    return field_names;
+}
+
+// Index nested-loop join: each outer row fetches its matches through the
+// index on the inner column.
+void index_join_left(const JoinColumn& outer, const FieldIndex& index, const JoinColumn& inner, JoinSink& sink) {
+    std::vector<int> matches;
+    for(std::size_t i=0;i<outer.rel.get_row_count();i++){
+        matches.clear();
+        index.lookup(join_value(outer,i),outer.size,inner,matches);
+        for(std::size_t j=0;j<matches.size();j++){
+            sink.consume(outer.rel.get_position(i),matches[j]);
+        }
+        if(matches.empty()){
+            sink.consume(outer.rel.get_position(i),-1);
+        }
+    }
+}
+
+}
+
+bool Schema::check_join_columns(const Schema& schema2, const std::vector<std::string>& field_names) const {
+    for(std::size_t c=0;c<field_names.size();c++){
+        if(is_int(column_index.at(field_names[c]))!=schema2.is_int(schema2.column_index.at(field_names[c]))){
+            std::cout<<"Cannot join an int column with a string column."<<std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+void Schema::join_natural_left(Schema &schema2,Join_Conditions jc,JoinSink& sink){
+    std::vector<std::string> field_names=split_field_names(jc.field_name);
+    if(!check_join_columns(schema2,field_names)){
+        return;
+    }
+    // Merge and hash joins match packed keys, which also take ints and
+    // several columns.
+    bool packed_keys=jc.op==EQUAL && (jc.implementation==MERGE || jc.implementation==HASH || jc.implementation==GRACE_HASH);
+    if(field_names.size()>1 && !packed_keys){
+        std::cout<<"Composite keys need an equality merge or hash join."<<std::endl;
+        return;
+    }
+
+    // Anything else but string equality runs as a sort-based range join,
+    // whatever the implementation asked for.
+    bool int_keys=is_int(column_index.at(field_names[0]));
+    if(!packed_keys && (jc.op!=EQUAL || int_keys)){
+        if(jc.op==BAND && !int_keys){
+            std::cout<<"Band joins need int columns."<<std::endl;
+            return;
+        }
+        MappedRelation rel1(jc.rel1_filename, get_row_size());
+        MappedRelation rel2(jc.rel2_filename, schema2.get_row_size());
+        JoinColumn outer=get_join_column(rel1,jc.field_name);
+        JoinColumn inner=schema2.get_join_column(rel2,jc.field_name);
+        share_dictionary(outer,inner);
+        range_join_left(outer,inner,int_keys,jc.op,jc.band,jc.memory_budget,sink);
+        return;
+    }
+
     switch(jc.implementation){
         case NESTED:{  
-            FILE* rel1 = fopen(jc.rel1_filename.c_str(), "rb");
-            FILE* rel2 = fopen(jc.rel2_filename.c_str(), "rb");
-                                            
-            std::vector<int> pos_vec;
-                        
-            int offset1=column_offset.at(jc.field_name);
-            int offset2=schema2.get_column_offset().at(jc.field_name);
-
-            int index1=column_index.at(jc.field_name);
-            int index2=schema2.get_column_index().at(jc.field_name);
-                       
-
-            fseek(rel1,0,SEEK_END);
-            int rel_size1 = ftell(rel1);
-
-            fseek(rel2,0,SEEK_END);
-            int rel_size2 = ftell(rel2);
-
-            int pos1=0; 
-            fseek(rel1,0,SEEK_SET);            
-            while(pos1<rel_size1) {
-                int row_pos1=pos1;
-                pos1+=get_header_size();
-                fseek(rel1,pos1+offset1,SEEK_SET);
-                int column_size1=atoi(metadata[index1].first.c_str()+1);            
-                char* value1=(char*)malloc(sizeof(char)*column_size1);                
-                fread(value1,sizeof(char),column_size1,rel1);
-
-                int pos2=0;
-                fseek(rel2,0,SEEK_SET);
-                bool found_joinable=false;
-                while(pos2<rel_size2){
-                    int row_pos2=pos2;
-                    pos2+=schema2.get_header_size();
-                    fseek(rel2,pos2+offset2,SEEK_SET);
-                    int column_size2=atoi(schema2.get_metadata()[index2].first.c_str()+1);            
-                    char* value2=(char*)malloc(sizeof(char)*column_size2);                
-                    fread(value2,sizeof(char),column_size2,rel2);
-                    if(!strcmp(value1,value2)){
-                        found_joinable=true;
-                        //std::cout<<"Joined "<<value1<<" at positions "<<row_pos1<<","<<row_pos2<<std::endl;
-                        pos_vector.push_back(std::make_pair(row_pos1,row_pos2));
-                    }
-                    //std::cout<<value1<<" "<<value2<<std::endl;
-                    pos2+=schema2.get_data_size();
-                }      
-                if(!found_joinable){
-                    pos_vector.push_back(std::make_pair(row_pos1,-1));
-                }          
-                pos1+=get_data_size();
+            MappedRelation rel1(jc.rel1_filename, get_row_size());
+            MappedRelation rel2(jc.rel2_filename, schema2.get_row_size());
+            JoinColumn outer=get_join_column(rel1,jc.field_name);
+            JoinColumn inner=schema2.get_join_column(rel2,jc.field_name);
+
+            // A secondary index on the inner field replaces the inner loop.
+            FieldIndex index;
+            if(index.open(field_index_filename(jc.rel2_filename,jc.field_name),rel2)){
+                index_join_left(outer,index,inner,sink);
+                break;
             }
-            fclose(rel1); 
-            fclose(rel2);          
+
+            // Otherwise the inner relation is scanned once per chunk of
+            // outer keys that fits the memory budget.
+            share_dictionary(outer,inner);
+            block_nested_join_left(outer,inner,jc.memory_budget,scan_threads,sink);
             break;
         }
         case NESTED_EXISTING_INDEX:{
-
-            FILE* rel1 = fopen(jc.rel1_filename.c_str(), "rb");
-            FILE* rel2 = fopen(jc.rel2_filename.c_str(), "rb");
-
-            int offset1=column_offset.at(jc.field_name);
-            int offset2=schema2.get_column_offset().at(jc.field_name);
-
-            int index1=column_index.at(jc.field_name);
-            int index2=schema2.get_column_index().at(jc.field_name);
-                       
-                                            
-            std::vector<int> pos_vec;
-
-            for(unsigned i = 0 ; i < index_map.size() ; i++){
-               
-                int pos1=index_map[i].second+i*4;
-                int row_pos1 = pos1;
-                pos1+=get_header_size();
-                fseek(rel1,pos1+offset1,SEEK_SET);
-                int column_size1=atoi(metadata[index1].first.c_str()+1);            
-                char* value1=(char*)malloc(sizeof(char)*column_size1);                
-                fread(value1,sizeof(char),column_size1,rel1);
-               
-                for(unsigned j = 0 ; j < schema2.get_index_map().size() ; j++){
-
-                    int pos2 = schema2.get_index_map()[j].second+i*4;
-                    int row_pos2=pos2;
-                    pos2+=schema2.get_header_size();
-                    fseek(rel2,pos2+offset2,SEEK_SET);
-                    int column_size2=atoi(schema2.get_metadata()[index2].first.c_str()+1);            
-                    char* value2=(char*)malloc(sizeof(char)*column_size2);                
-                    fread(value2,sizeof(char),column_size2,rel2);
-                    
-                    if(!strcmp(value1,value2)){
-                        //std::cout<<"Joined "<<value1<<" at positions "<<row_pos1<<","<<row_pos2<<std::endl;
-                        pos_vector.push_back(std::make_pair(row_pos1,row_pos2));
-                    }
-                }
-            } 
-
-            fclose(rel1); 
-            fclose(rel2);
+            MappedRelation rel1(jc.rel1_filename, get_row_size());
+            MappedRelation rel2(jc.rel2_filename, schema2.get_row_size());
+
+            JoinColumn outer=get_join_column(rel1,jc.field_name);
+            JoinColumn inner=schema2.get_join_column(rel2,jc.field_name);
+
+            // The index is built on first use and kept next to the relation.
+            // Where it cannot be written, the join runs without it.
+            std::string index_filename=field_index_filename(jc.rel2_filename,jc.field_name);
+            FieldIndex index;
+            if(index.open(index_filename,rel2) ||
+               (FieldIndex::build(inner,index_filename,jc.memory_budget) && index.open(index_filename,rel2))){
+                index_join_left(outer,index,inner,sink);
+                break;
+            }
+            share_dictionary(outer,inner);
+            block_nested_join_left(outer,inner,jc.memory_budget,scan_threads,sink);
             break;
         }
         case NESTED_NEW_INDEX:{
-            FILE* rel1 = fopen(jc.rel1_filename.c_str(), "rb");
-            FILE* rel2 = fopen(jc.rel2_filename.c_str(), "rb");
+            MappedRelation rel1(jc.rel1_filename, get_row_size());
+            MappedRelation rel2(jc.rel2_filename, schema2.get_row_size());
             FILE* ind1 = fopen("../data/csv/schema_test1.index","wb");
             FILE* ind2 = fopen("../data/csv/schema_test2.index","wb");
-            bool indexload = false;
-            std::vector<std::pair<char*,int>> index_map1;
-            std::vector<std::pair<char*,int>> index_map2;
-
-
-            std::vector<int> pos_vec;
-                        
-            int offset1=column_offset.at(jc.field_name);
-            int offset2=schema2.get_column_offset().at(jc.field_name);
-
-            int index1=column_index.at(jc.field_name);
-            int index2=schema2.get_column_index().at(jc.field_name);
-                       
-
-            fseek(rel1,0,SEEK_END);
-            int rel_size1 = ftell(rel1);
-
-            fseek(rel2,0,SEEK_END);
-            int rel_size2 = ftell(rel2);
-
-            int pos1=0; 
-            fseek(rel1,0,SEEK_SET);            
-            while(pos1<rel_size1) {
-                int row_pos1=pos1;
-                pos1+=get_header_size();
-                fseek(rel1,pos1+offset1,SEEK_SET);
-                int column_size1=atoi(metadata[index1].first.c_str()+1);            
-                char* value1=(char*)malloc(sizeof(char)*column_size1);                
-                fread(value1,sizeof(char),column_size1,rel1);
+            std::vector<std::pair<const char*,int>> index_map2;
+
+            JoinColumn outer=get_join_column(rel1,jc.field_name);
+            JoinColumn inner=schema2.get_join_column(rel2,jc.field_name);
+            share_dictionary(outer,inner);
+            int column_size1=outer.size;
+            int column_size2=inner.size;
+            int column_size=std::min(column_size1,column_size2);
+
+            // build the index of the inner relation once
+            index_map2.reserve(rel2.get_row_count());
+            for(std::size_t j=0;j<rel2.get_row_count();j++){
+                int row_pos2=rel2.get_position(j);
+                const char* value2=join_value(inner,j);
+                fwrite(value2,sizeof(char),column_size2,ind2);
+                fwrite(&row_pos2,sizeof(int),1,ind2);
+                index_map2.push_back(std::make_pair(value2,row_pos2));
+            }
+
+            for(std::size_t i=0;i<rel1.get_row_count();i++) {
+                int row_pos1=rel1.get_position(i);
+                const char* value1=join_value(outer,i);
                 fwrite(value1,sizeof(char),column_size1,ind1);
                 fwrite(&row_pos1,sizeof(int),1,ind1);
-                index_map1.push_back(std::make_pair(value1,row_pos1));
-                int pos2=0;
-                fseek(rel2,0,SEEK_SET);
+
                 bool found_joinable=false;
-                if(!indexload){
-                    while(pos2<rel_size2){
-
-                        int row_pos2=pos2;
-                        pos2+=schema2.get_header_size();
-                        fseek(rel2,pos2+offset2,SEEK_SET);
-                        int column_size2=atoi(schema2.get_metadata()[index2].first.c_str()+1);            
-                        char* value2=(char*)malloc(sizeof(char)*column_size2);                
-                        fread(value2,sizeof(char),column_size2,rel2);
-                        
-                        fwrite(value2,sizeof(char),column_size2,ind2);
-                        fwrite(&row_pos2,sizeof(int),1,ind2);
-
-                        index_map2.push_back(std::make_pair(value2,row_pos2));
-
-                        if(!strcmp(value1,value2)){
-                            found_joinable=true;
-                            //std::cout<<"Joined "<<value1<<" at positions "<<row_pos1<<","<<row_pos2<<std::endl;
-                            pos_vector.push_back(std::make_pair(row_pos1,row_pos2));
-                        }
-                        //std::cout<<value1<<" "<<value2<<std::endl;
-                        pos2+=schema2.get_data_size();
-                    }  
-                }else{
-                    for(unsigned i=0 ;i < index_map2.size() ; i++){
-                        if(!strcmp(value1,index_map2[i].first)){
-                            found_joinable=true;
-                            //std::cout<<"Joined "<<value1<<" at positions "<<row_pos1<<","<<row_pos2<<std::endl;
-                            pos_vector.push_back(std::make_pair(row_pos1,index_map2[i].second));
-                        }
+                for(unsigned j=0 ;j < index_map2.size() ; j++){
+                    if(!strncmp(value1,index_map2[j].first,column_size)){
+                        found_joinable=true;
+                        sink.consume(row_pos1,index_map2[j].second);
                     }
-
-                }   
-
+                }
                 if(!found_joinable){
-                    pos_vector.push_back(std::make_pair(row_pos1,-1));
+                    sink.consume(row_pos1,-1);
                 }          
-                pos1+=get_data_size();
-
-                indexload=true;
             }
 
-            fclose(rel1); 
             fclose(ind1);
-            fclose(rel2);
             fclose(ind2);          
-
             break;
         }
-        case MERGE:{                                                                                  
-            std::vector<std::string> data1,data2;
-            data1=get_table(jc.rel1_filename,jc.field_name);
-            data2=schema2.get_table(jc.rel2_filename,jc.field_name);
-
-            // keep track of old indexes
-            auto mapped_indexes1=sort_indexes(data1); 
-            auto mapped_indexes2=sort_indexes(data2);
-
-            // sort alphabetically
-            std::sort(data1.begin(),data1.end());
-            std::sort(data2.begin(),data2.end());
-
-            unsigned j_start=0;            
-            for(unsigned i=0;i<data1.size();i++){
-                bool found_joinable=false;
-                for(unsigned j=j_start;j<data2.size();j++){                                   
-                    //std::cout<<data1[i]<<" "<<data2[j]<<" "<<i<<" "<<j<<std::endl;
-                    if(data1[i]==data2[j]){
-                        found_joinable=true;                            
-                        pos_vector.push_back(std::make_pair(mapped_indexes1[i]*(get_row_size()),mapped_indexes2[j]*(schema2.get_row_size())));
-                        j_start=j;
-                    //    std::cout<<data1[i]<<" "<<data2[j]<<" "<<i<<" "<<j<<std::endl;
-                    }
-                    else if(data1[i]<data2[j]){                                            
-                        break;  // skip to next i if key2>key1
-                    }                                
-                }
-                if(!found_joinable){
-                    pos_vector.push_back(std::make_pair(mapped_indexes1[i]*(get_row_size()),-1));
-                }
-            }
-                      
+        case MERGE:{
+            MappedRelation rel1(jc.rel1_filename, get_row_size());
+            MappedRelation rel2(jc.rel2_filename, schema2.get_row_size());
+
+            JoinKey outer=get_join_key(rel1,field_names);
+            JoinKey inner=schema2.get_join_key(rel2,field_names);
+            pair_join_keys(outer, inner);
+            merge_join_left(outer, inner, jc.memory_budget, sink);
             break;
         }
         case HASH:{
-            std::vector<std::string> data1;          
-            std::unordered_map<std::string, std::vector<int>> data2;             
-            data1=this->get_table(jc.rel1_filename,jc.field_name); // vector
-            data2=schema2.get_table_map(jc.rel2_filename,jc.field_name); // hashmap
-            /*for(auto k:data2){
-                std::cout<<k.first<<":";
-                for(auto j:k.second){
-                    std::cout<<j<<",";
-                } 
-                std::cout<<std::endl;       
-            }*/
-            /*for(unsigned i=0;i<data1.size();i++){
-                std::cout<<data1[i]<<std::endl;
-            }*/
-            for(unsigned i=0;i<data1.size();i++){
-                if(data2.find(data1[i])!=data2.end()){
-                    for(auto idx:data2[data1[i]]){
-                        pos_vector.push_back(std::make_pair(i*(get_row_size()),idx*schema2.get_row_size()));
-                    }                    
-                }
-                else{
-                    pos_vector.push_back(std::make_pair(i*(get_row_size()),-1));
-                }
-            }            
+            MappedRelation rel1(jc.rel1_filename, get_row_size());
+            MappedRelation rel2(jc.rel2_filename, schema2.get_row_size());
+
+            JoinKey outer=get_join_key(rel1,field_names);
+            JoinKey inner=schema2.get_join_key(rel2,field_names);
+            pair_join_keys(outer, inner);
+            hash_join_left(outer, inner, scan_threads, sink);
+            break;
+        }
+        case GRACE_HASH:{
+            MappedRelation rel1(jc.rel1_filename, get_row_size());
+            MappedRelation rel2(jc.rel2_filename, schema2.get_row_size());
+
+            JoinKey outer=get_join_key(rel1,field_names);
+            JoinKey inner=schema2.get_join_key(rel2,field_names);
+            pair_join_keys(outer, inner);
+            grace_hash_join_left(outer, inner, jc.memory_budget, scan_threads, sink);
             break;
         }
         default:{
             break;
         }
     }
-    return pos_vector;
 }
 
 std::vector<std::pair<int,int>> Schema::join_natural_right(Schema &schema2,Join_Conditions jc){
     std::vector<std::pair<int,int>> pos_vector;
+    JoinCollector collector(pos_vector);
+    join_natural_right(schema2,jc,collector);
+    return pos_vector;
+}
+
+void Schema::join_natural_right(Schema &schema2,Join_Conditions jc,JoinSink& sink){
     Join_Conditions jc2;
     jc2=jc;
     jc2.rel2_filename=jc.rel1_filename;
     jc2.rel1_filename=jc.rel2_filename;
-    pos_vector=schema2.join_natural_left(*this,jc2);
-    for(unsigned i=0;i<pos_vector.size();i++){
-        pos_vector[i]=std::make_pair(pos_vector[i].second,pos_vector[i].first);
-    }
-    return pos_vector;
+    jc2.op=mirror_operator(jc.op);
+    SwappedJoinSink swapped(sink);
+    schema2.join_natural_left(*this,jc2,swapped);
 }
 
 std::vector<std::pair<int,int>> Schema::join_natural_full(Schema &schema2,Join_Conditions jc){
-    std::vector<std::pair<int,int>> pos_vector_left,pos_vector_right,pos_vector;    
-    pos_vector_left=join_natural_left(schema2,jc);
-    pos_vector_right=join_natural_right(schema2,jc);
-    for(unsigned i=0;i<pos_vector_left.size();i++){
-        pos_vector.push_back(pos_vector_left[i]);
-        for(unsigned j=0;j<pos_vector_right.size();j++){
-            if(pos_vector_left[i]!=pos_vector_right[j]){
-                pos_vector.push_back(pos_vector_right[j]);
-            }
-        }        
-    }
+    std::vector<std::pair<int,int>> pos_vector;
+    JoinCollector collector(pos_vector);
+    join_natural_full(schema2,jc,collector);
     return pos_vector;
-}
\ No newline at end of file
+}
+
+void Schema::join_natural_full(Schema &schema2,Join_Conditions jc,JoinSink& sink){
+    // One left join, then the rows of rel2 it never matched.
+    MappedRelation rel2(jc.rel2_filename, schema2.get_row_size());
+    MatchedRowsSink matched(sink, schema2.get_row_size(), rel2.get_row_count());
+    join_natural_left(schema2,jc,matched);
+    for(std::size_t j=0;j<rel2.get_row_count();j++){
+        if(!matched.is_matched(j)){
+            sink.consume(-1,rel2.get_position(j));
+        }
+    }
+}
+
+std::vector<int> Schema::join_semi(Schema &schema2,Join_Conditions jc){
+    std::vector<int> positions;
+    RowCollector collector(positions);
+    join_semi(schema2,jc,collector);
+    return positions;
+}
+
+void Schema::join_semi(Schema &schema2,Join_Conditions jc,JoinSink& sink){
+    join_existence(schema2,jc,false,sink);
+}
+
+std::vector<int> Schema::join_anti(Schema &schema2,Join_Conditions jc){
+    std::vector<int> positions;
+    RowCollector collector(positions);
+    join_anti(schema2,jc,collector);
+    return positions;
+}
+
+void Schema::join_anti(Schema &schema2,Join_Conditions jc,JoinSink& sink){
+    join_existence(schema2,jc,true,sink);
+}
+
+void Schema::join_existence(Schema &schema2,Join_Conditions jc,bool anti,JoinSink& sink){
+    std::vector<std::string> field_names=split_field_names(jc.field_name);
+    if(!check_join_columns(schema2,field_names)){
+        return;
+    }
+    MappedRelation rel1(jc.rel1_filename, get_row_size());
+    MappedRelation rel2(jc.rel2_filename, schema2.get_row_size());
+
+    // Range conditions only ask whether the range of a row of rel1 is empty.
+    if(jc.op!=EQUAL){
+        if(field_names.size()>1){
+            std::cout<<"Composite keys need an equality merge or hash join."<<std::endl;
+            return;
+        }
+        bool int_keys=is_int(column_index.at(field_names[0]));
+        if(jc.op==BAND && !int_keys){
+            std::cout<<"Band joins need int columns."<<std::endl;
+            return;
+        }
+        JoinColumn outer=get_join_column(rel1,jc.field_name);
+        JoinColumn inner=schema2.get_join_column(rel2,jc.field_name);
+        share_dictionary(outer,inner);
+        range_semi_join(outer,inner,int_keys,jc.op,jc.band,anti,jc.memory_budget,sink);
+        return;
+    }
+
+    // Equality builds the set of keys of rel2 and ignores the
+    // implementation, whatever it was.
+    JoinKey outer=get_join_key(rel1,field_names);
+    JoinKey inner=schema2.get_join_key(rel2,field_names);
+    pair_join_keys(outer, inner);
+    semi_join(outer, inner, anti, jc.memory_budget, scan_threads, sink);
+}
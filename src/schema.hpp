@@ -1,11 +1,21 @@
 #ifndef SCHEMA_H
 #define SCHEMA_H
 
+#include <cstddef>
+#include <iostream>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include "auxiliary.hpp"
+#include "dictionary.hpp"
+#include "hash_index.hpp"
+#include "join_key.hpp"
+#include "join_sink.hpp"
+#include "mapped_relation.hpp"
+#include "range_join.hpp"
+#include "semi_join.hpp"
+#include "zone_map.hpp"
 #include "BPlusTree/bpt.h"
 #include <unordered_map>
 
@@ -15,23 +25,35 @@ enum join_implementation{
     NESTED_EXISTING_INDEX,
     NESTED_NEW_INDEX,
     MERGE,
-    HASH
+    HASH,
+    GRACE_HASH
+};
+
+enum storage_layout{
+    ROW_MAJOR,
+    PAX, // column minipages per page, see pax_layout.hpp
+    COMPRESSED // compressed blocks of rows, see compressed_layout.hpp
 };
 
 enum join_type{
     NATURAL_INNER,
     NATURAL_LEFT,
     NATURAL_RIGHT,
-    NATURAL_FULL
+    NATURAL_FULL,
+    SEMI, // rows of rel1 with a match in rel2, once each
+    ANTI // rows of rel1 without a match in rel2
 };
 
 class Join_Conditions{
     public:
         std::string rel1_filename;
         std::string rel2_filename;
-        std::string field_name;
+        std::string field_name; // "a,b" joins on the composite key (a, b)
         join_implementation implementation;
         join_type type;
+        std::size_t memory_budget = 256 << 20; // bytes a join may hold before spilling to temporary files
+        join_operator op = EQUAL; // other operators, and int columns, always run as a range join
+        int band = 0; // for op = BAND
 };
 class Schema {
 public:
@@ -46,18 +68,23 @@ public:
     std::unordered_map<std::string, int> get_column_index() const;
     std::unordered_map<std::string, int> get_column_offset() const;
     std::vector<std::pair<int, int> > get_index_map() const;
-    std::unordered_map<std::size_t*,int> get_index_hash() const;
+    JoinColumn get_join_column(const MappedRelation& rel, const std::string& field_name) const; // encoded fields read as their values
+    JoinKey get_join_key(const MappedRelation& rel, const std::vector<std::string>& field_names) const; // pair it with the other side's before use
+    const HashIndex& get_index_hash() const;
     std::string get_filename() const;
+    void set_scan_threads(unsigned threads); // threads used by table scans, 0 uses every core
     std::vector<std::string> get_table(const std::string& rel_filename,const std::string& field_name) const; // returns only chosen field
     std::unordered_map<std::string, std::vector<int>> get_table_map(const std::string& rel_filename,const std::string&field_name) const; // returns only chosen field and row index
-    void convert_to_bin(const std::string& csv_filename, const std::string& bin_filename, bool ignore_first_line = true) const;
+    void convert_to_bin(const std::string& csv_filename, const std::string& bin_filename, bool ignore_first_line = true, unsigned threads = 0, storage_layout layout = ROW_MAJOR) const; // threads = 0 uses every core
     void print_binary(const std::string& bin_filename) const;
     void create_index(const std::string& bin_filename, const std::string& index_filename) const;
-    void create_index_bplus(const std::string& bin_filename, const std::string& index_filename) const;
+    void create_index_bplus(const std::string& bin_filename, const std::string& index_filename, double fill_factor = 1.0) const;
     void create_index_hash(const std::string& bin_filename, const std::string& index_filename) const;
     void create_index_direct_hash(const std::string& csv_filename, const std::string& bin_filename, bool ignore_first_line) const;
     void create_index_indirect_hash(const std::string& bin_filename, const std::string& index_filename) const;
-    void load_data(int pos, const std::string& bin_filename);
+    void create_field_index(const std::string& bin_filename, const std::string& field_name, std::size_t memory_budget) const; // used by search_field and joins on that field
+    void load_data(int pos, const std::string& bin_filename) const;
+    void load_data(int pos, const MappedRelation& rel, std::ostream& out = std::cout) const; // prints NULL columns for pos = -1
     void load_index(const std::string& index_filename);
     void load_index_bplus(const std::string& index_filename);
     void load_index_indirect_hash(const std::string& index_filename);
@@ -67,11 +94,20 @@ public:
     int search_for_key_direct_hash(int key, const std::string& bin_filename) const;
     int search_for_key_raw(int key, const std::string& bin_filename) const;
     std::vector<int> search_field(std::string field_name, std::string field_value, const std::string& bin_filename, int init_pos) const;
+    std::vector<int> search_field(std::string field_name, std::string field_value, const MappedRelation& rel, int init_pos) const;
     void join(Schema &schema2,Join_Conditions jc);  
     std::vector<std::pair<int,int>> join_natural_inner(Schema &schema2,Join_Conditions jc);
+    void join_natural_inner(Schema &schema2,Join_Conditions jc,JoinSink& sink);
     std::vector<std::pair<int,int>> join_natural_left(Schema &schema2,Join_Conditions jc);
+    void join_natural_left(Schema &schema2,Join_Conditions jc,JoinSink& sink); // pairs go to the sink as they are found
     std::vector<std::pair<int,int>> join_natural_right(Schema &schema2,Join_Conditions jc);
+    void join_natural_right(Schema &schema2,Join_Conditions jc,JoinSink& sink);
     std::vector<std::pair<int,int>> join_natural_full(Schema &schema2,Join_Conditions jc);
+    void join_natural_full(Schema &schema2,Join_Conditions jc,JoinSink& sink);
+    std::vector<int> join_semi(Schema &schema2,Join_Conditions jc); // positions in rel1
+    void join_semi(Schema &schema2,Join_Conditions jc,JoinSink& sink); // (pos1, -1) once per row of rel1
+    std::vector<int> join_anti(Schema &schema2,Join_Conditions jc);
+    void join_anti(Schema &schema2,Join_Conditions jc,JoinSink& sink);
 
     static const int TIMESTAMP_SIZE = 25;
     static const int HEADER_SIZE = TIMESTAMP_SIZE * sizeof(char) + 2 * sizeof(int);
@@ -79,7 +115,22 @@ public:
     
 private:    
     void compute_size();
+    bool write_rows(const std::string& csv_filename, const std::string& bin_filename, bool ignore_first_line, unsigned threads) const; // row-major, with its dictionary; false after saying why
+    bool check_join_columns(const Schema& schema2, const std::vector<std::string>& field_names) const; // prints why not
+    void join_existence(Schema &schema2,Join_Conditions jc,bool anti,JoinSink& sink); // join_semi and join_anti
     void compute_header_size();    
+    int get_column_size(int index) const; // size of column data in a row
+    int get_value_size(int index) const; // declared string width, also for encoded columns
+    bool is_int(int index) const;
+    bool is_encoded(int index) const; // "dNNN": a dictionary code in the row, the value in <bin>.dict
+    // The dictionary of the encoded column at index, NULL if rel is not open.
+    // Throws std::runtime_error if <bin>.dict is missing or stale.
+    const DictionaryColumn* get_dictionary(const MappedRelation& rel, int index) const;
+    void check_dictionaries(const MappedRelation& rel) const; // of every encoded column
+    std::vector<int> get_field_widths() const; // header fields, then columns
+    std::vector<ZoneField> get_zone_fields() const; // the key, then columns
+    void print_row(const char* data, const Dictionary& dictionary, std::ostream& out = std::cout) const; // data points past the header
+    void encode_row(const char* line, const char* line_end, int key, const char* timestamp, const Dictionary& dictionary, char* out) const; // one CSV line into a row
     int size;
     int header_size;
     std::string schema_filename;
@@ -88,7 +139,8 @@ private:
     std::vector<std::pair<int, int> > index_map;
     std::unordered_map<std::string, int> column_index;
     std::unordered_map<std::string, int> column_offset; // offset from start of row data (does not include header)
-    std::unordered_map<std::size_t*,int> index_hash;
+    HashIndex index_hash;
+    unsigned scan_threads = 0;
 
 };
 
@@ -0,0 +1,133 @@
+#include "semi_join.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "hash_index.hpp"
+#include "parallel.hpp"
+
+namespace {
+
+const std::size_t MIN_CHUNK_KEYS = 1024;
+
+// Distinct keys of key_size bytes in a linear probing table at load factor
+// one half at most.
+class KeySet {
+public:
+    KeySet(std::size_t key_size, std::size_t max_keys) : key_size(key_size), max_keys(max_keys) {
+        std::size_t capacity = 16;
+        while(capacity < 2 * max_keys) {
+            capacity *= 2;
+        }
+        mask = capacity - 1;
+        keys.reserve(max_keys * key_size);
+        hashes.reserve(max_keys);
+    }
+
+    bool full() const {
+        return hashes.size() >= max_keys;
+    }
+
+    void clear() {
+        keys.clear();
+        hashes.clear();
+        table.assign(mask + 1, 0);
+    }
+
+    void insert(const char* key, uint64_t hash) {
+        std::size_t slot = hash & mask;
+        for(; table[slot] != 0; slot = (slot + 1) & mask) {
+            if(equals(table[slot] - 1, key, hash)) {
+                return;
+            }
+        }
+        keys.insert(keys.end(), key, key + key_size);
+        hashes.push_back(hash);
+        table[slot] = hashes.size();
+    }
+
+    bool contains(const char* key, uint64_t hash) const {
+        for(std::size_t slot = hash & mask; table[slot] != 0; slot = (slot + 1) & mask) {
+            if(equals(table[slot] - 1, key, hash)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    bool equals(std::size_t i, const char* key, uint64_t hash) const {
+        return hashes[i] == hash && memcmp(&keys[i * key_size], key, key_size) == 0;
+    }
+
+    std::size_t key_size;
+    std::size_t max_keys;
+    std::size_t mask;
+    std::vector<char> keys;
+    std::vector<uint64_t> hashes;
+    std::vector<uint32_t> table; // index + 1, 0 for a free slot
+};
+
+}
+
+void semi_join(const JoinKey& outer, const JoinKey& inner, bool anti, std::size_t memory_budget,
+               unsigned threads, JoinSink& sink) {
+    const MappedRelation& rel1 = outer.columns[0].rel;
+    const MappedRelation& rel2 = inner.columns[0].rel;
+    const std::size_t key_size = outer.size;
+    // Key, hash and two table slots per distinct inner key.
+    const std::size_t key_bytes = key_size + sizeof(uint64_t) + 2 * sizeof(uint32_t);
+    const std::size_t chunk_keys = std::max(MIN_CHUNK_KEYS, memory_budget / key_bytes);
+    KeySet keys(key_size, std::max<std::size_t>(1, std::min(chunk_keys, rel2.get_row_count())));
+
+    std::vector<char> key(key_size);
+    std::vector<char> matched; // per outer row, when there are several chunks
+    bool single_chunk = true; // a single chunk decides every outer row at once
+    std::size_t next = 0; // first inner row not in a chunk yet
+    do {
+        keys.clear();
+        while(next < rel2.get_row_count() && !keys.full()) {
+            keys.insert(key.data(), hash_bytes(key.data(), pack_join_key(inner, next, key.data())));
+            next++;
+        }
+        if(single_chunk && next < rel2.get_row_count()) {
+            single_chunk = false;
+            matched.assign(rel1.get_row_count(), 0);
+        }
+
+        // Rows found (or for a single anti chunk, not found) in the set.
+        scan_morsels<std::vector<std::size_t>>(rel1.get_row_count(), threads,
+            [&](std::size_t begin, std::size_t end, std::vector<std::size_t>& rows) {
+                std::vector<char> key1(key_size);
+                for(std::size_t i = begin; i < end; i++) {
+                    if(!single_chunk && matched[i]) {
+                        continue;
+                    }
+                    bool found = keys.contains(key1.data(), hash_bytes(key1.data(), pack_join_key(outer, i, key1.data())));
+                    if(found != (single_chunk && anti)) {
+                        rows.push_back(i);
+                    }
+                }
+            },
+            [&](std::vector<std::size_t>& rows) {
+                for(std::size_t k = 0; k < rows.size(); k++) {
+                    if(single_chunk) {
+                        sink.consume(rel1.get_position(rows[k]), -1);
+                    }
+                    else {
+                        matched[rows[k]] = 1;
+                    }
+                }
+            });
+    } while(next < rel2.get_row_count());
+
+    if(!single_chunk) {
+        for(std::size_t i = 0; i < rel1.get_row_count(); i++) {
+            if((matched[i] != 0) != anti) {
+                sink.consume(rel1.get_position(i), -1);
+            }
+        }
+    }
+}
@@ -0,0 +1,19 @@
+#ifndef SEMI_JOIN_H
+#define SEMI_JOIN_H
+
+#include <cstddef>
+
+#include "join_key.hpp"
+#include "join_sink.hpp"
+
+// Semi-join (anti = false) or anti-join (anti = true) on two JoinKeys paired
+// with pair_join_keys: the outer rows that have, or lack, an inner row with
+// an equal key, each once as (outer position, -1), in row order. The inner
+// side only builds a set of its distinct keys, in chunks that fit
+// memory_budget; with several chunks a byte per outer row remembers its
+// matches until the last one. The outer rows are probed in parallel morsels,
+// threads = 0 uses every core.
+void semi_join(const JoinKey& outer, const JoinKey& inner, bool anti, std::size_t memory_budget,
+               unsigned threads, JoinSink& sink);
+
+#endif // SEMI_JOIN_H
@@ -0,0 +1,237 @@
+#include "zone_map.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#include <unistd.h>
+
+#include "hash_index.hpp"
+#include "join_key.hpp"
+#include "parallel.hpp"
+
+namespace {
+
+struct ZoneMapHeader {
+    int magic;
+    int row_size;
+    int row_count;
+    int zone_rows;
+    int field_count; // followed by field_count ZoneFields, then the zones
+    uint64_t fingerprint; // MappedRelation::get_fingerprint of the relation
+};
+
+const int BLOOM_HASHES = 3;
+const std::size_t BLOOM_BITS = ZONE_BLOOM_BYTES * 8;
+
+// A zone holds, for each field: min, max, then the bloom filter of strings.
+std::size_t field_size(const ZoneField& field) {
+    return 2 * field.width + (field.type == ZONE_STRING ? ZONE_BLOOM_BYTES : 0);
+}
+
+inline std::size_t bloom_bit(uint64_t hash, int i) {
+    return (hash + i * ((hash >> 32) | 1)) & (BLOOM_BITS - 1);
+}
+
+}
+
+ZoneMap::ZoneMap() : file(NULL), zone_count(0), zone_rows(0), zone_size(0), zones_start(0) {}
+
+ZoneMap::~ZoneMap() {
+    delete file;
+}
+
+bool ZoneMap::build(const MappedRelation& rel, const std::vector<ZoneField>& fields, const std::string& zone_filename, unsigned threads) {
+    const std::size_t rows = rel.get_row_count();
+    const std::size_t zone_count = (rows + ZONE_ROWS - 1) / ZONE_ROWS;
+    std::vector<std::size_t> field_start;
+    std::size_t zone_size = 0;
+    for(std::size_t f = 0; f < fields.size(); f++) {
+        field_start.push_back(zone_size);
+        zone_size += field_size(fields[f]);
+    }
+
+    std::vector<char> zones(zone_count * zone_size, 0);
+    if(threads == 0) {
+        threads = default_thread_count();
+    }
+    threads = std::max<std::size_t>(1, std::min<std::size_t>(threads, zone_count));
+    // Rows are read a run at a time, so PAX pages are assembled and
+    // compressed blocks decompressed once for all the fields.
+    run_parallel(threads, [&](unsigned t) {
+        std::vector<char> key, buffer;
+        for(std::size_t z = t; z < zone_count; z += threads) {
+            const std::size_t first = z * ZONE_ROWS;
+            const std::size_t last = std::min<std::size_t>(rows, first + ZONE_ROWS);
+            for(std::size_t f = 0; f < fields.size(); f++) {
+                if(fields[f].type == ZONE_INT) {
+                    const int low = INT_MAX, high = INT_MIN;
+                    memcpy(&zones[z * zone_size + field_start[f]], &low, sizeof(int));
+                    memcpy(&zones[z * zone_size + field_start[f]] + sizeof(int), &high, sizeof(int));
+                }
+            }
+            for(std::size_t r = first; r < last;) {
+                const char* run;
+                std::size_t count = std::min(rel.read_rows(r, buffer, &run), last - r);
+                for(std::size_t i = 0; i < count; i++, r++) {
+                    const char* row = run + i * rel.get_row_size();
+                    for(std::size_t f = 0; f < fields.size(); f++) {
+                        const ZoneField& field = fields[f];
+                        char* min = &zones[z * zone_size + field_start[f]];
+                        char* max = min + field.width;
+                        if(field.type == ZONE_INT) {
+                            int value, low, high;
+                            memcpy(&value, row + field.offset, sizeof(int));
+                            memcpy(&low, min, sizeof(int));
+                            memcpy(&high, max, sizeof(int));
+                            low = std::min(low, value);
+                            high = std::max(high, value);
+                            memcpy(min, &low, sizeof(int));
+                            memcpy(max, &high, sizeof(int));
+                            continue;
+                        }
+
+                        unsigned char* bloom = reinterpret_cast<unsigned char*>(max + field.width);
+                        key.resize(field.width);
+                        copy_join_key(row + field.offset, field.width, key.data(), field.width);
+                        if(r == first || memcmp(key.data(), min, field.width) < 0) {
+                            memcpy(min, key.data(), field.width);
+                        }
+                        if(r == first || memcmp(key.data(), max, field.width) > 0) {
+                            memcpy(max, key.data(), field.width);
+                        }
+                        uint64_t hash = hash_bytes(key.data(), strnlen(key.data(), field.width));
+                        for(int h = 0; h < BLOOM_HASHES; h++) {
+                            std::size_t bit = bloom_bit(hash, h);
+                            bloom[bit / 8] |= 1 << (bit % 8);
+                        }
+                    }
+                }
+            }
+        }
+    });
+
+    ZoneMapHeader header = {ZONE_MAP_MAGIC, rel.get_row_size(), static_cast<int>(rows), ZONE_ROWS, static_cast<int>(fields.size()),
+                            rel.get_fingerprint()};
+    FILE* zone_file = fopen(zone_filename.c_str(), "wb");
+    if(!zone_file) {
+        return false;
+    }
+    bool written = fwrite(&header, sizeof(header), 1, zone_file) == 1 &&
+                   fwrite(fields.data(), sizeof(ZoneField), fields.size(), zone_file) == fields.size() &&
+                   fwrite(zones.data(), 1, zones.size(), zone_file) == zones.size();
+    if(fclose(zone_file) != 0 || !written) {
+        unlink(zone_filename.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool ZoneMap::open(const std::string& zone_filename, const MappedRelation& rel) {
+    delete file;
+    file = NULL;
+    fields.clear();
+    field_start.clear();
+
+    if(access(zone_filename.c_str(), R_OK) != 0) {
+        return false;
+    }
+    file = new MappedRelation(zone_filename, 1);
+    ZoneMapHeader header;
+    bool valid = file->get_size() >= sizeof(header);
+    if(valid) {
+        memcpy(&header, file->get_data(), sizeof(header));
+        valid = header.magic == ZONE_MAP_MAGIC && header.row_size == rel.get_row_size() &&
+                static_cast<std::size_t>(header.row_count) == rel.get_row_count() && header.fingerprint == rel.get_fingerprint() &&
+                header.zone_rows > 0 &&
+                header.field_count >= 0 && sizeof(header) + header.field_count * sizeof(ZoneField) <= file->get_size();
+    }
+    if(valid) {
+        fields.resize(header.field_count);
+        memcpy(fields.data(), file->get_data() + sizeof(header), fields.size() * sizeof(ZoneField));
+        zone_size = 0;
+        for(std::size_t f = 0; f < fields.size(); f++) {
+            valid = valid && fields[f].width > 0 && (fields[f].type == ZONE_STRING || fields[f].width == sizeof(int));
+            field_start.push_back(zone_size);
+            zone_size += field_size(fields[f]);
+        }
+        zone_rows = header.zone_rows;
+        zone_count = (rel.get_row_count() + zone_rows - 1) / zone_rows;
+        zones_start = sizeof(header) + fields.size() * sizeof(ZoneField);
+        valid = valid && zones_start + zone_count * zone_size <= file->get_size();
+    }
+    if(!valid) {
+        delete file;
+        file = NULL;
+        fields.clear();
+        field_start.clear();
+    }
+    return valid;
+}
+
+bool ZoneMap::is_open() const {
+    return file != NULL;
+}
+
+std::size_t ZoneMap::get_zone_count() const {
+    return zone_count;
+}
+
+std::size_t ZoneMap::get_zone_rows() const {
+    return zone_rows;
+}
+
+const char* ZoneMap::find(std::size_t zone, int offset, const ZoneField** field) const {
+    for(std::size_t f = 0; f < fields.size(); f++) {
+        if(fields[f].offset == offset) {
+            *field = &fields[f];
+            return file->get_data() + zones_start + zone * zone_size + field_start[f];
+        }
+    }
+    return NULL;
+}
+
+bool ZoneMap::may_equal(std::size_t zone, int offset, const char* value, std::size_t length) const {
+    const ZoneField* field;
+    const char* min = find(zone, offset, &field);
+    if(!min || field->type != ZONE_STRING) {
+        return true;
+    }
+    if(length > static_cast<std::size_t>(field->width)) {
+        return false;
+    }
+    const char* max = min + field->width;
+    std::string key(field->width, '\0');
+    copy_join_key(value, length, &key[0], field->width);
+    if(memcmp(key.data(), min, field->width) < 0 || memcmp(key.data(), max, field->width) > 0) {
+        return false;
+    }
+
+    const unsigned char* bloom = reinterpret_cast<const unsigned char*>(max + field->width);
+    uint64_t hash = hash_bytes(key.data(), strnlen(key.data(), field->width));
+    for(int i = 0; i < BLOOM_HASHES; i++) {
+        std::size_t bit = bloom_bit(hash, i);
+        if(!(bloom[bit / 8] & (1 << (bit % 8)))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ZoneMap::may_equal(std::size_t zone, int offset, int value) const {
+    const ZoneField* field;
+    const char* min = find(zone, offset, &field);
+    if(!min || field->type != ZONE_INT) {
+        return true;
+    }
+    int low, high;
+    memcpy(&low, min, sizeof(int));
+    memcpy(&high, min + sizeof(int), sizeof(int));
+    return low <= value && value <= high;
+}
+
+std::string zone_map_filename(const std::string& bin_filename) {
+    return bin_filename + ".zones";
+}
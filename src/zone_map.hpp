@@ -0,0 +1,69 @@
+#ifndef ZONE_MAP_H
+#define ZONE_MAP_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "mapped_relation.hpp"
+
+// Per-zone metadata of a .bin relation, kept next to it (<bin>.zones). Rows
+// are cut into zones of ZONE_ROWS rows; for every mapped field a zone stores
+// the smallest and largest value and, for strings, a bloom filter of its
+// values. A scan skips the zones that cannot hold its value: ranges prune
+// clustered fields such as the key, the bloom filters prune equality
+// searches on the rest. The zone map stores the fingerprint of the file it
+// was built over and is ignored for any other version of it.
+const int ZONE_MAP_MAGIC = 0x324e4f5a; // "ZON2"
+const int ZONE_ROWS = 4096;
+const int ZONE_BLOOM_BYTES = ZONE_ROWS; // 8 bits per row, about 3% false positives
+
+enum zone_field_type{
+    ZONE_INT,
+    ZONE_STRING // fixed width, compared like a C string
+};
+
+struct ZoneField {
+    int offset; // offset from start of row (includes header)
+    int width;
+    int type; // zone_field_type
+};
+
+class ZoneMap {
+public:
+    ZoneMap();
+    ~ZoneMap();
+
+    // False if the file cannot be written, scans then go without it.
+    static bool build(const MappedRelation& rel, const std::vector<ZoneField>& fields, const std::string& zone_filename, unsigned threads);
+
+    // Opens the zone map of rel, false if it is missing or was built over a
+    // different version of the file.
+    bool open(const std::string& zone_filename, const MappedRelation& rel);
+    bool is_open() const;
+    std::size_t get_zone_count() const;
+    std::size_t get_zone_rows() const;
+    // Whether some row of zone may have value in the field at offset. Fields
+    // without zone maps always may.
+    bool may_equal(std::size_t zone, int offset, const char* value, std::size_t length) const;
+    bool may_equal(std::size_t zone, int offset, int value) const;
+
+private:
+    ZoneMap(const ZoneMap&);
+    ZoneMap& operator=(const ZoneMap&);
+
+    const char* find(std::size_t zone, int offset, const ZoneField** field) const; // NULL if the field is not mapped
+
+    MappedRelation* file;
+    std::size_t zone_count;
+    std::size_t zone_rows;
+    std::size_t zone_size; // bytes per zone
+    std::size_t zones_start; // offset of the first zone in the file
+    std::vector<ZoneField> fields;
+    std::vector<std::size_t> field_start; // offset of each field in a zone
+};
+
+// Where the zone map of a .bin file lives: <bin>.zones
+std::string zone_map_filename(const std::string& bin_filename);
+
+#endif // ZONE_MAP_H